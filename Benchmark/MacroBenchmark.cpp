@@ -0,0 +1,409 @@
+/**
+ * End-to-end benchmark of the whole pipeline on the bundled datasets
+ *
+ * Every dataset is solved with every number of threads in a separate process,
+ * so the peak memory of one run is not affected by the others. For each stage
+ * (data extraction, puzzle solving, visualization) the wall time, the CPU time
+ * of all threads and the peak resident memory reached by the end of the stage
+ * are recorded.
+ *
+ * The correctness of the result is checked by the fingerprint of the layout,
+ * a hash of the pairs of neighbouring pieces, which does not depend on the rotation
+ * of the whole puzzle. When the solved image of the dataset is present in the output
+ * directory of the datasets, the mean error of the result scaled to its size
+ * is reported too.
+ *
+ * A dataset given as COLUMNSxROWS is a synthetic puzzle created by PuzzleGenerator,
+ * its pieces have no images, so the visualization stage only computes
+ * the geometric layout.
+ *
+ * The results can be stored as the baselines. A run compared to the baselines
+ * reports a regression when the fingerprint differs or a time or the memory
+ * exceeds the baseline by more than the tolerance, and exits with status 1.
+ * A run without its baseline is reported the same way, and a missing or
+ * unreadable baselines file is an error unless the baselines are being stored.
+ *
+ * usage: macrobenchmark [-d datasets directory] [-s 208,572,...] [-n 1,2,4,...]
+ *                       [-b baselines file] [-u] [-r tolerance] [-o output directory]
+ *                       [-D NAME=value ...]
+ * -u stores the results as the new baselines instead of comparing to them
+ */
+
+#define PUZZLE_NO_MAIN
+#include "../Puzzle.cpp"
+
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace MacroBenchmark {
+
+	const int NUM_STAGES = 3;
+	const char *STAGE_NAMES[NUM_STAGES] = { "extraction", "solving", "visualization" };
+
+	struct StageMeasurement {
+		double wallTime, cpuTime;
+		// peak resident set size in kilobytes
+		long peakMemory;
+	};
+
+	// measurement of one run of the pipeline
+	struct Run {
+		string dataset;
+		int threads;
+		StageMeasurement stages[NUM_STAGES];
+		unsigned long long fingerprint;
+		// mean error of the result compared to the solved image, negative if not available
+		double imageError;
+	};
+
+	double now() {
+		timespec t;
+		clock_gettime(CLOCK_MONOTONIC,&t);
+		return t.tv_sec + t.tv_nsec * 1e-9;
+	}
+
+	// user and system time of all threads of the process
+	double cpuTime() {
+		rusage usage;
+		getrusage(RUSAGE_SELF,&usage);
+		return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec
+			+ (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+	}
+
+	long peakMemory() {
+		rusage usage;
+		getrusage(RUSAGE_SELF,&usage);
+		return usage.ru_maxrss;
+	}
+
+	// measures the stage between its construction and the call of stop
+	class StageTimer {
+		double wallStart, cpuStart;
+
+		public:
+
+		StageTimer() : wallStart(now()), cpuStart(cpuTime()) {
+		}
+
+		StageMeasurement stop() const {
+			StageMeasurement m = { now()-wallStart, cpuTime()-cpuStart, peakMemory() };
+			return m;
+		}
+	};
+
+	// FNV-1a hash of the sorted pairs of the ids of neighbouring pieces
+	unsigned long long fingerprint(const PuzzleLayout &layout) {
+		vector< pair<int,int> > neighbours;
+		for (int y = 0; y < layout.rows(); y++) {
+			for (int x = 0; x < layout.columns(); x++) {
+				if (layout.at(x,y) == NULL) continue;
+				int id = layout.at(x,y)->piece->id;
+				if (x+1 < layout.columns() && layout.at(x+1,y) != NULL) {
+					int other = layout.at(x+1,y)->piece->id;
+					neighbours.push_back(make_pair(min(id,other),max(id,other)));
+				}
+				if (y+1 < layout.rows() && layout.at(x,y+1) != NULL) {
+					int other = layout.at(x,y+1)->piece->id;
+					neighbours.push_back(make_pair(min(id,other),max(id,other)));
+				}
+			}
+		}
+		sort(neighbours.begin(),neighbours.end());
+
+		unsigned long long hash = 14695981039346656037ULL;
+		for (unsigned int i = 0; i < neighbours.size(); i++) {
+			int values[2] = { neighbours[i].first, neighbours[i].second };
+			for (int k = 0; k < 2; k++) {
+				for (int b = 0; b < 4; b++) {
+					hash ^= (values[k] >> (8*b)) & 0xFF;
+					hash *= 1099511628211ULL;
+				}
+			}
+		}
+		return hash;
+	}
+
+	bool fileExists(const string &fileName) {
+		return ifstream(fileName.c_str()).good();
+	}
+
+	// mean error of the result scaled to the size of the solved image
+	double imageError(Image result, const string &solvedFileName) {
+		if (!fileExists(solvedFileName)) return -1.0;
+		Image solved(solvedFileName);
+		Geometry size(solved.columns(),solved.rows());
+		size.aspect(true);
+		result.resize(size);
+		result.compare(solved);
+		return result.normalizedMeanError();
+	}
+
+	// the scans of the dataset are numbered 1f.jpg, 1b.jpg, 2f.jpg, ...
+	void datasetFiles(const string &directory, vector<string> &front, vector<string> &back) {
+		for (int i = 1; ; i++) {
+			ostringstream prefix;
+			prefix << directory << "/" << i;
+			if (!fileExists(prefix.str()+"f.jpg") || !fileExists(prefix.str()+"b.jpg")) break;
+			front.push_back(prefix.str()+"f.jpg");
+			back.push_back(prefix.str()+"b.jpg");
+		}
+		if (front.empty())
+			throw "no scans in the dataset directory";
+	}
+
+	// runs the whole pipeline, called in the child process
+	Run solveDataset(const string &root, const string &dataset, int threads, const string &outputDirectory) {
+		NUM_THREADS = threads;
+		Run run;
+		run.dataset = dataset;
+		run.threads = threads;
+
+		StageTimer extraction;
+		PieceStore store;
+		int columns, rows;
+		char separator;
+		bool synthetic = sscanf(dataset.c_str(),"%d%c%d",&columns,&separator,&rows) == 3 && separator == 'x';
+		if (synthetic) {
+			PuzzleGenerator(columns,rows,SYNTHETIC_SEED).generate(store);
+		} else {
+			vector<string> front, back;
+			datasetFiles(root+"/input/"+dataset,front,back);
+			loadPieces(front,back,store);
+		}
+		Pieces pieces = store.getPieces();
+		run.stages[0] = extraction.stop();
+
+		StageTimer solving;
+		Solver solver;
+		PuzzleLayout layout = solver.assemblePuzzle(pieces);
+		run.stages[1] = solving.stop();
+
+		run.fingerprint = fingerprint(layout);
+		run.imageError = -1.0;
+		if (synthetic) {
+			StageTimer visualization;
+			GeometricLayoutComputer computer;
+			computer.computeLayout(layout);
+			run.stages[2] = visualization.stop();
+			return run;
+		}
+
+		StageTimer visualization;
+		Visualizer visualizer;
+		Image result = visualizer.visualize(layout);
+		run.stages[2] = visualization.stop();
+
+		run.imageError = imageError(result,root+"/output/solved"+dataset+".jpg");
+		if (!outputDirectory.empty()) {
+			ostringstream fileName;
+			fileName << outputDirectory << "/solved" << dataset << "-" << threads << ".jpg";
+			result.write(fileName.str());
+		}
+		return run;
+	}
+
+	// one line of the results and of the baselines file
+	string format(const Run &run) {
+		ostringstream line;
+		line << run.dataset << " " << run.threads << " " << hex << run.fingerprint << dec
+		     << " " << run.imageError;
+		for (int s = 0; s < NUM_STAGES; s++) {
+			line << " " << run.stages[s].wallTime << " " << run.stages[s].cpuTime
+			     << " " << run.stages[s].peakMemory;
+		}
+		return line.str();
+	}
+
+	bool parse(const string &text, Run &run) {
+		istringstream line(text);
+		line >> run.dataset >> run.threads >> hex >> run.fingerprint >> dec >> run.imageError;
+		for (int s = 0; s < NUM_STAGES; s++) {
+			line >> run.stages[s].wallTime >> run.stages[s].cpuTime >> run.stages[s].peakMemory;
+		}
+		return !line.fail();
+	}
+
+	// solves the dataset in a child process so the peak memory is measured separately,
+	// returns false if the child failed
+	bool measure(const string &root, const string &dataset, int threads, const string &outputDirectory, Run &run) {
+		int channel[2];
+		if (pipe(channel) != 0)
+			throw "cannot create a pipe";
+		cout.flush();
+		pid_t child = fork();
+		if (child < 0)
+			throw "cannot fork";
+		if (child == 0) {
+			close(channel[0]);
+			int status = 1;
+			try {
+				string line = format(solveDataset(root,dataset,threads,outputDirectory)) + "\n";
+				if (write(channel[1],line.c_str(),line.size()) == ssize_t(line.size()))
+					status = 0;
+			} catch (const char *message) {
+				cerr << "error: " << message << endl;
+			}
+			_exit(status);
+		}
+
+		close(channel[1]);
+		string text;
+		char buffer[256];
+		ssize_t length;
+		while ((length = read(channel[0],buffer,sizeof(buffer))) > 0) {
+			text.append(buffer,length);
+		}
+		close(channel[0]);
+		int status;
+		waitpid(child,&status,0);
+		return WIFEXITED(status) && WEXITSTATUS(status) == 0 && parse(text,run);
+	}
+
+	vector<Run> loadBaselines(const string &fileName) {
+		vector<Run> baselines;
+		ifstream file(fileName.c_str());
+		if (!file)
+			throw "cannot open baselines file";
+		string line;
+		while (getline(file,line)) {
+			Run run;
+			if (line.empty() || line[0] == '#') continue;
+			if (!parse(line,run))
+				throw "bad line in baselines file";
+			baselines.push_back(run);
+		}
+		return baselines;
+	}
+
+	void saveBaselines(const string &fileName, const vector<Run> &runs) {
+		ofstream file(fileName.c_str());
+		file << "# dataset threads fingerprint image-error";
+		for (int s = 0; s < NUM_STAGES; s++) {
+			file << " " << STAGE_NAMES[s] << ":wall,cpu,peak-kB";
+		}
+		file << endl;
+		for (unsigned int i = 0; i < runs.size(); i++) {
+			file << format(runs[i]) << endl;
+		}
+	}
+
+	// reports the regressions of the run against the baseline, returns their number
+	int compare(const Run &run, const Run &baseline, double tolerance) {
+		int regressions = 0;
+		if (run.fingerprint != baseline.fingerprint) {
+			printf("  REGRESSION %s/%d: the layout differs from the baseline\n",run.dataset.c_str(),run.threads);
+			regressions++;
+		}
+		for (int s = 0; s < NUM_STAGES; s++) {
+			const StageMeasurement &m = run.stages[s], &b = baseline.stages[s];
+			if (m.wallTime > b.wallTime * (1+tolerance)) {
+				printf("  REGRESSION %s/%d: %s wall time %.2fs, baseline %.2fs\n",
+					run.dataset.c_str(),run.threads,STAGE_NAMES[s],m.wallTime,b.wallTime);
+				regressions++;
+			}
+			if (m.peakMemory > b.peakMemory * (1+tolerance)) {
+				printf("  REGRESSION %s/%d: %s peak memory %ld kB, baseline %ld kB\n",
+					run.dataset.c_str(),run.threads,STAGE_NAMES[s],m.peakMemory,b.peakMemory);
+				regressions++;
+			}
+		}
+		return regressions;
+	}
+
+	void print(const Run &run) {
+		printf("%-6s %3d threads  %016llx",run.dataset.c_str(),run.threads,run.fingerprint);
+		if (run.imageError >= 0) printf("  error %.4f",run.imageError);
+		printf("\n");
+		for (int s = 0; s < NUM_STAGES; s++) {
+			const StageMeasurement &m = run.stages[s];
+			printf("  %-14s %9.2fs wall %9.2fs cpu %9ld kB peak\n",STAGE_NAMES[s],m.wallTime,m.cpuTime,m.peakMemory);
+		}
+		fflush(stdout);
+	}
+
+	// splits the comma separated list
+	vector<string> split(const string &list) {
+		vector<string> items;
+		istringstream stream(list);
+		string item;
+		while (getline(stream,item,',')) {
+			if (!item.empty()) items.push_back(item);
+		}
+		return items;
+	}
+
+};
+
+int main(int argc, char** argv) {
+	using namespace MacroBenchmark;
+
+	string root = "Datasets", baselinesFileName = "baselines.txt", outputDirectory;
+	vector<string> datasets = split("208,572,1008,3168");
+	vector<string> threadCounts = split("1,2,4,8");
+	bool update = false;
+	double tolerance = 0.1;
+	vector<Run> baselines;
+	try {
+		for (int i = 1; i < argc; i++) {
+			string param = argv[i];
+			if (param == "-u") {
+				update = true;
+				continue;
+			}
+			if (i+1 >= argc)
+				throw "missing value of a parameter";
+			if (param == "-d") root = argv[++i];
+			else if (param == "-s") datasets = split(argv[++i]);
+			else if (param == "-n") threadCounts = split(argv[++i]);
+			else if (param == "-b") baselinesFileName = argv[++i];
+			else if (param == "-r") tolerance = atof(argv[++i]);
+			else if (param == "-o") outputDirectory = argv[++i];
+			else if (param == "-D") Configuration::define(argv[++i]);
+			else throw "unknown parameter";
+		}
+		if (!update)
+			baselines = loadBaselines(baselinesFileName);
+	} catch (const char *message) {
+		cerr << "error: " << message << endl;
+		return 2;
+	}
+
+	vector<Run> runs;
+	int regressions = 0;
+	for (unsigned int d = 0; d < datasets.size(); d++) {
+		for (unsigned int t = 0; t < threadCounts.size(); t++) {
+			Run run;
+			if (!measure(root,datasets[d],atoi(threadCounts[t].c_str()),outputDirectory,run)) {
+				printf("  FAILED %s/%s\n",datasets[d].c_str(),threadCounts[t].c_str());
+				regressions++;
+				continue;
+			}
+			print(run);
+			// the number of threads must not change the solution
+			if (t > 0 && !runs.empty() && runs.back().dataset == run.dataset && runs.back().fingerprint != run.fingerprint) {
+				printf("  REGRESSION %s/%d: the layout depends on the number of threads\n",run.dataset.c_str(),run.threads);
+				regressions++;
+			}
+			bool compared = update;
+			for (unsigned int b = 0; b < baselines.size(); b++) {
+				if (baselines[b].dataset == run.dataset && baselines[b].threads == run.threads) {
+					regressions += compare(run,baselines[b],tolerance);
+					compared = true;
+				}
+			}
+			if (!compared) {
+				printf("  REGRESSION %s/%d: no baseline\n",run.dataset.c_str(),run.threads);
+				regressions++;
+			}
+			runs.push_back(run);
+		}
+	}
+
+	if (update)
+		saveBaselines(baselinesFileName,runs);
+	return regressions > 0 ? 1 : 0;
+}
@@ -0,0 +1,565 @@
+/**
+ * Microbenchmarks of the core kernels of the method
+ *
+ * Every benchmark repeats one operation on the inputs generated from a fixed seed
+ * until it runs at least MIN_TIME seconds and reports the time and the number
+ * of memory allocations per operation together with the throughput.
+ *
+ * The largest successive matchings take seconds per operation, select the benchmarks
+ * by a part of their names to skip them.
+ *
+ * usage: benchmark [-j results.json] [substring of the names of benchmarks to run]
+ */
+
+#define PUZZLE_NO_MAIN
+#include "../Puzzle.cpp"
+
+#include <ctime>
+#include <fstream>
+
+// number of calls of the global operator new, the array versions use it too
+long long numAllocations = 0;
+
+void* operator new(size_t size) throw(std::bad_alloc) {
+	__sync_fetch_and_add(&numAllocations,1);
+	void *p = malloc(size > 0 ? size : 1);
+	if (p == NULL)
+		throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void *p) throw() {
+	free(p);
+}
+
+namespace Benchmark {
+
+	// the minimal time spent in one benchmark in seconds
+	const double MIN_TIME = 0.5;
+
+	struct Result {
+		string name;
+		long long operations;
+		double nsPerOp;
+		double allocationsPerOp;
+		// processed items per second
+		double throughput;
+		string unit;
+	};
+
+	vector<Result> results;
+	// only the benchmarks containing this string in the name are run
+	string filter;
+
+	double now() {
+		timespec t;
+		clock_gettime(CLOCK_MONOTONIC,&t);
+		return t.tv_sec + t.tv_nsec * 1e-9;
+	}
+
+	// runs the operation op() in batches of doubling size until MIN_TIME passes,
+	// one operation processes given number of items of given unit
+	template <class Operation>
+	void run(const string &name, Operation &op, double items, const string &unit) {
+		long long operations = 0;
+		long long allocations = numAllocations;
+		double start = now(), elapsed = 0.0;
+		// warm up, the slow operations are measured only once, in the warm up
+		op();
+		if (now() - start >= MIN_TIME) {
+			operations = 1;
+			elapsed = now() - start;
+		} else {
+			allocations = numAllocations;
+			start = now();
+		}
+		for (long long batch = 1; elapsed < MIN_TIME; batch *= 2) {
+			for (long long i = 0; i < batch; i++) {
+				op();
+			}
+			operations += batch;
+			elapsed = now() - start;
+		}
+		Result result = {
+			name, operations,
+			elapsed * 1e9 / operations,
+			double(numAllocations - allocations) / operations,
+			items * operations / elapsed,
+			unit
+		};
+		results.push_back(result);
+		printf("%-48s %14.0f ns/op %10.1f allocs/op %14.0f %s/s\n",
+			name.c_str(),result.nsPerOp,result.allocationsPerOp,result.throughput,unit.c_str());
+		fflush(stdout);
+	}
+
+	void writeJSON(const string &fileName) {
+		ofstream file(fileName.c_str());
+		file << "[" << endl;
+		for (unsigned int i = 0; i < results.size(); i++) {
+			const Result &r = results[i];
+			file << "  { \"name\": \"" << r.name << "\", \"operations\": " << r.operations
+			     << ", \"ns_per_op\": " << r.nsPerOp << ", \"allocs_per_op\": " << r.allocationsPerOp
+			     << ", \"throughput\": " << r.throughput << ", \"unit\": \"" << r.unit << "/s\" }"
+			     << (i+1 < results.size() ? "," : "") << endl;
+		}
+		file << "]" << endl;
+	}
+
+	// the side of a piece of a jigsaw puzzle with a tab of given direction
+	// (-1, 0, +1) along the x-axis, the side has one point per pixel
+	Shape pieceSide(Random &random, int tab, double length) {
+		Shape side;
+		double center = 0.5 + 0.1 * (random.uniform()-0.5);
+		double height = length * (0.2 + 0.1 * random.uniform());
+		for (int i = 0; i < length; i++) {
+			double u = i / length;
+			double y = -tab * height * exp(-pow((u-center)/0.08,2)) + 1.5 * random.uniform();
+			side.push_back(RealPoint(i,y));
+		}
+		return side;
+	}
+
+	// the closed contour of a square piece with random tabs
+	Shape pieceShape(Random &random, double size) {
+		Shape shape;
+		for (int k = 0; k < 4; k++) {
+			Shape side = pieceSide(random,random.integer(3)-1,size);
+			RigidTransformation t(Utils::DegreesToRadians(90*k),0,0);
+			const RealPoint corners[4] = { RealPoint(0,0), RealPoint(size,0), RealPoint(size,size), RealPoint(0,size) };
+			t.translation = corners[k];
+			Geometry2D::transformInPlace(side,t);
+			shape.insert(shape.end(),side.begin(),side.end());
+		}
+		return shape;
+	}
+
+	// an edge with the colours changing along the shape
+	Edge* createEdge(Random &random, int tab, double length) {
+		Edge *edge = new Edge;
+		edge->id = 0;
+		edge->piece = NULL;
+		edge->type = EdgeType(tab);
+		edge->shape = pieceSide(random,tab,length);
+		ColorSignature colors;
+		for (unsigned int i = 0; i < edge->shape.size(); i++) {
+			colors.push_back(FixedHSL::fromRGB(random.uniform(),random.uniform(),random.uniform()));
+		}
+		edge->color.assign(colors);
+		return edge;
+	}
+
+	// bitmap of given size with random discs
+	Bitmap discs(Random &random, int columns, int rows, int count) {
+		Bitmap bitmap(columns,rows);
+		for (int k = 0; k < count; k++) {
+			int cx = random.integer(columns), cy = random.integer(rows);
+			int radius = 5 + random.integer(40);
+			for (int y = max(cy-radius,0); y <= min(cy+radius,rows-1); y++) {
+				for (int x = max(cx-radius,0); x <= min(cx+radius,columns-1); x++) {
+					if ((x-cx)*(x-cx) + (y-cy)*(y-cy) <= radius*radius)
+						bitmap.set(x,y);
+				}
+			}
+		}
+		return bitmap;
+	}
+
+	// white piece of given shape on the black background
+	Image pieceImage(const Shape &shape, int columns, int rows) {
+		Bitmap mask = ShapeUtils::shapeBitmap(columns,rows,shape);
+		vector<unsigned char> pixels(3*columns*rows);
+		for (int y = 0; y < rows; y++) {
+			for (int x = 0; x < columns; x++) {
+				if (mask.get(x,y))
+					fill(&pixels[3*(y*columns+x)],&pixels[3*(y*columns+x)+3],255);
+			}
+		}
+		return Image(columns,rows,"RGB",CharPixel,&pixels[0]);
+	}
+
+	struct ShapeAlignBenchmark {
+		ShapeAligner aligner;
+		Shape shape1, shape2;
+		double sink;
+
+		ShapeAlignBenchmark(Random &random) : sink(0) {
+			shape1 = pieceSide(random,+1,300);
+			shape2 = Geometry2D::transform(pieceSide(random,+1,300),RigidTransformation(0.1,5,-3));
+		}
+		void operator()() {
+			sink += aligner.shapeAlign(shape1,shape2).t.rotationAngle;
+		}
+	};
+
+	struct LineAlignBenchmark {
+		ShapeAligner aligner;
+		Shape shape;
+		double sink;
+
+		LineAlignBenchmark(Random &random) : shape(pieceSide(random,0,300)), sink(0) {
+		}
+		void operator()() {
+			sink += aligner.lineAlign(shape,0.3).rotationAngle;
+		}
+	};
+
+	// the first given number of levels of the comparison of two edges,
+	// from the lowest resolution
+	template <int COMPONENTS>
+	struct RecomputeScoreBenchmark {
+		ScaledEdge edge1, edge2;
+		int levels;
+		double sink;
+
+		RecomputeScoreBenchmark(Random &random, int levels) : levels(levels), sink(0) {
+			edge1 = CompatibilityClassificator::createScaledEdge(createEdge(random,+1,300),COMPONENTS);
+			edge2 = CompatibilityClassificator::createScaledEdge(createEdge(random,-1,300),COMPONENTS);
+		}
+		~RecomputeScoreBenchmark() {
+			delete edge1.back();
+			delete edge2.back();
+			CompatibilityClassificator::deleteScaledEdge(edge1);
+			CompatibilityClassificator::deleteScaledEdge(edge2);
+		}
+		void operator()() {
+			CompatibilityClassificator classificator(edge1,edge2);
+			for (int i = 0; i < levels; i++) {
+				sink += classificator.recomputeScore<COMPONENTS>().shape;
+			}
+		}
+	};
+
+	struct MinCostMatchingBenchmark {
+		MinCostMatching matching;
+		double sink;
+
+		MinCostMatchingBenchmark(Random &random, int size) : matching(size), sink(0) {
+			for (int u = 0; u < size; u++) {
+				for (int v = 0; v < size; v++) {
+					matching.setCost(u,v,random.uniform());
+				}
+			}
+		}
+		void operator()() {
+			MinCostMatching m = matching;
+			sink += m.getMinCostMatching()[0];
+		}
+	};
+
+	// the first MATCHINGS successive matchings, each operation starts from
+	// a copy of the initialised instance, so it does not depend on the number
+	// of operations run before
+	struct SuccessiveMatchingBenchmark {
+		static const int MATCHINGS = 4;
+		SuccessiveMinCostMatching matching;
+		double sink;
+
+		SuccessiveMatchingBenchmark(Random &random, int size) : matching(size), sink(0) {
+			for (int u = 0; u < size; u++) {
+				for (int v = 0; v < size; v++) {
+					matching.setCost(u,v,random.uniform());
+				}
+			}
+			matching.init();
+		}
+		void operator()() {
+			SuccessiveMinCostMatching m = matching;
+			for (int i = 0; i < MATCHINGS; i++) {
+				sink += m.getNextMatching()[0];
+			}
+		}
+	};
+
+	// rows of the compatibility table of a synthetic puzzle, the samples of the edges
+	// are either allocated one after another in the order of their ids, as if they
+	// were stored in a few large arrays, or scattered over the heap in a random order
+	struct TableRowsBenchmark {
+		static const int ROWS = 16;
+		PieceStore store;
+		Edges edges, rows;
+		ScaledEdges scaledEdges;
+		EdgeScores::Kernel kernel;
+		vector<char*> fillers;
+		double sink;
+
+		TableRowsBenchmark(bool packed) : sink(0) {
+			PuzzleGenerator generator(12,12,1);
+			generator.generate(store);
+			Pieces pieces = store.getPieces();
+			edges.resize(4*pieces.size());
+			for (unsigned int i = 0; i < pieces.size(); i++) {
+				for (int k = 0; k < 4; k++) {
+					edges[pieces[i]->edges[k]->id] = pieces[i]->edges[k];
+				}
+			}
+			relocate(packed);
+			for (unsigned int i = 0; i < edges.size() && int(rows.size()) < ROWS; i += 7) {
+				if (edges[i]->type != FRAME)
+					rows.push_back(edges[i]);
+			}
+			int components = EdgeScores::activeComponents();
+			kernel = EdgeScores::kernel(components);
+			scaledEdges = CompatibilityTable::scaleEdges(edges,components);
+		}
+		~TableRowsBenchmark() {
+			CompatibilityTable::deleteScaledEdges(scaledEdges);
+			for (unsigned int i = 0; i < fillers.size(); i++) {
+				delete[] fillers[i];
+			}
+		}
+		// copies the samples of every edge into new memory, the old memory
+		// is released only at the end so it is not reused
+		void relocate(bool packed) {
+			Random random(10);
+			Permutation order = random.permutation(edges.size());
+			if (packed)
+				sort(order.begin(),order.end());
+			vector<Shape> oldShapes(edges.size());
+			vector<ColorPlanes> oldColors(edges.size());
+			for (unsigned int i = 0; i < order.size(); i++) {
+				Edge &edge = store.edge(order[i]/4,order[i]%4);
+				Shape shape(edge.shape);
+				ColorPlanes color(edge.color);
+				edge.shape.swap(oldShapes[i]);
+				edge.color.swap(oldColors[i]);
+				edge.shape.swap(shape);
+				edge.color.swap(color);
+				if (!packed)
+					fillers.push_back(new char[4096 + random.integer(61440)]);
+			}
+		}
+		void operator()() {
+			for (unsigned int i = 0; i < rows.size(); i++) {
+				EdgeScores row(rows[i]);
+				(row.*kernel.init)(scaledEdges);
+				sink += row.best.shape;
+			}
+		}
+	};
+
+	struct ComponentsBenchmark {
+		Bitmap bitmap;
+		double sink;
+
+		ComponentsBenchmark(Random &random) : bitmap(discs(random,1024,1024,200)), sink(0) {
+		}
+		void operator()() {
+			sink += ComponentExtractor(bitmap).extractComponents().size();
+		}
+	};
+
+	struct SmoothBenchmark {
+		Bitmap bitmap;
+		double sink;
+
+		SmoothBenchmark(Random &random) : bitmap(discs(random,1024,1024,200)), sink(0) {
+		}
+		void operator()() {
+			MorphologicProcessor processor(bitmap);
+			sink += processor.smooth(3.0).rows();
+		}
+	};
+
+	// edges of a piece detected around its expected position
+	struct EdgeTilesBenchmark {
+		Image image;
+		RealPoints positions;
+		double radius;
+		double sink;
+
+		EdgeTilesBenchmark(const Shape &shape, RealPoint position)
+			: image(pieceImage(shape,600,600)), positions(1,position), radius(200), sink(0) {
+		}
+		void operator()() {
+			PatternAlignOptimizer optimizer(image,positions,radius);
+			sink += positions[0].x;
+		}
+	};
+
+	// matching of the shape to the edges, with or without the silhouette
+	struct PatternAlignBenchmark {
+		Shape shape, silhouette;
+		RealPoint position;
+		PatternAlignOptimizer optimizer;
+		double sink;
+
+		PatternAlignBenchmark(const Shape &shape, RealPoint position, bool useSilhouette)
+			: shape(shape), position(position),
+			  optimizer(pieceImage(shape,600,600),RealPoints(1,position),200), sink(0) {
+			if (useSilhouette)
+				silhouette = shape;
+		}
+		void operator()() {
+			sink += optimizer.optimizeAlign(Geometry2D::rotate(shape,0.2),position,silhouette)[0].x;
+		}
+	};
+
+	struct GaussianBlurBenchmark {
+		vector<double> signal;
+		double sigma;
+		double sink;
+
+		GaussianBlurBenchmark(Random &random, double sigma) : signal(2000), sigma(sigma), sink(0) {
+			for (unsigned int i = 0; i < signal.size(); i++) {
+				signal[i] = random.uniform();
+			}
+		}
+		void operator()() {
+			sink += SignalProcessor<double>::gaussianBlur(signal,sigma)[0];
+		}
+	};
+
+	struct IdentifyCornersBenchmark {
+		Shape shape;
+		double sink;
+
+		IdentifyCornersBenchmark(Random &random) : shape(pieceShape(random,300)), sink(0) {
+		}
+		void operator()() {
+			sink += ShapeAnalysis::IdentifyCorners(shape)[0];
+		}
+	};
+
+	string name(const string &prefix, int parameter) {
+		ostringstream out;
+		out << prefix << parameter;
+		return out.str();
+	}
+
+	// determines if the benchmark of given name is run, the inputs
+	// of the other benchmarks are not created at all
+	bool selected(const string &name) {
+		return name.find(filter) != string::npos;
+	}
+
+	void runAll() {
+		string n = "ShapeAligner::shapeAlign";
+		if (selected(n)) {
+			Random random(1);
+			ShapeAlignBenchmark b(random);
+			run(n,b,b.shape1.size()+b.shape2.size(),"points");
+		}
+		n = "ShapeAligner::lineAlign";
+		if (selected(n)) {
+			Random random(2);
+			LineAlignBenchmark b(random);
+			run(n,b,b.shape.size(),"points");
+		}
+		for (int levels = 1; levels <= RESOLUTION_DEPTH; levels++) {
+			n = name("CompatibilityClassificator::recomputeScore/shape/levels=",levels);
+			if (selected(n)) {
+				Random random(3);
+				RecomputeScoreBenchmark<SHAPE_SCORE> b(random,levels);
+				run(n,b,1,"pairs");
+			}
+		}
+		for (int levels = 1; levels <= RESOLUTION_DEPTH; levels++) {
+			n = name("CompatibilityClassificator::recomputeScore/color/levels=",levels);
+			if (selected(n)) {
+				Random random(3);
+				RecomputeScoreBenchmark<ALL_SCORES> b(random,levels);
+				run(n,b,1,"pairs");
+			}
+		}
+		const int sizes[] = { 50, 100, 200, 400 };
+		for (int i = 0; i < 4; i++) {
+			n = name("MinCostMatching::getMinCostMatching/size=",sizes[i]);
+			if (selected(n)) {
+				Random random(4);
+				MinCostMatchingBenchmark b(random,sizes[i]);
+				run(n,b,1,"matchings");
+			}
+		}
+		// every successive matching solves size-1 restricted problems,
+		// the sizes are the numbers of frame pieces of real puzzles
+		const int frameSizes[] = { 25, 50, 100 };
+		for (int i = 0; i < 3; i++) {
+			n = name("SuccessiveMinCostMatching::getNextMatching/size=",frameSizes[i]);
+			if (selected(n)) {
+				Random random(5);
+				SuccessiveMatchingBenchmark b(random,frameSizes[i]);
+				run(n,b,SuccessiveMatchingBenchmark::MATCHINGS,"matchings");
+			}
+		}
+		// the lower resolutions are always allocated together by scaleEdges(),
+		// in one level only the edges of the store are visited
+		const int depths[] = { 1, RESOLUTION_DEPTH };
+		const char *layouts[] = { "scattered", "packed" };
+		for (int i = 0; i < 2; i++) {
+			for (int j = 0; j < 2; j++) {
+				n = name(string("EdgeScores::init/") + layouts[j] + "/depth=",depths[i]);
+				if (selected(n)) {
+					int oldDepth = RESOLUTION_DEPTH;
+					RESOLUTION_DEPTH = depths[i];
+					TableRowsBenchmark b(j == 1);
+					run(n,b,TableRowsBenchmark::ROWS,"rows");
+					RESOLUTION_DEPTH = oldDepth;
+				}
+			}
+		}
+		n = "ComponentExtractor::extractComponents";
+		if (selected(n)) {
+			Random random(6);
+			ComponentsBenchmark b(random);
+			run(n,b,1024*1024,"pixels");
+		}
+		n = "MorphologicProcessor::smooth";
+		if (selected(n)) {
+			Random random(6);
+			SmoothBenchmark b(random);
+			run(n,b,1024*1024,"pixels");
+		}
+		Random random(7);
+		Shape shape = Geometry2D::translate(pieceShape(random,300),RealPoint(150,150));
+		RealPoint position = Geometry2D::centerOfPolygon(shape);
+		n = "PatternAlignOptimizer/edges";
+		if (selected(n)) {
+			EdgeTilesBenchmark b(shape,position);
+			run(n,b,1,"pieces");
+		}
+		n = "PatternAlignOptimizer::optimizeAlign/rotations";
+		if (selected(n)) {
+			PatternAlignBenchmark b(shape,position,false);
+			run(n,b,1,"pieces");
+		}
+		n = "PatternAlignOptimizer::optimizeAlign/silhouette";
+		if (selected(n)) {
+			PatternAlignBenchmark b(shape,position,true);
+			run(n,b,1,"pieces");
+		}
+		const int sigmas[] = { 2, 10 };
+		for (int i = 0; i < 2; i++) {
+			n = name("SignalProcessor::gaussianBlur/sigma=",sigmas[i]);
+			if (selected(n)) {
+				Random random(8);
+				GaussianBlurBenchmark b(random,sigmas[i]);
+				run(n,b,b.signal.size(),"samples");
+			}
+		}
+		n = "ShapeAnalysis::IdentifyCorners";
+		if (selected(n)) {
+			Random random(9);
+			IdentifyCornersBenchmark b(random);
+			run(n,b,b.shape.size(),"points");
+		}
+	}
+
+};
+
+int main(int argc, char** argv) {
+	string jsonFileName;
+	for (int i = 1; i < argc; i++) {
+		string param = argv[i];
+		if (param == "-j" && i+1 < argc)
+			jsonFileName = argv[++i];
+		else
+			Benchmark::filter = param;
+	}
+
+	Benchmark::runAll();
+
+	if (!jsonFileName.empty())
+		Benchmark::writeJSON(jsonFileName);
+	return 0;
+}
@@ -0,0 +1,198 @@
+/**
+ * Configuration sets the parameters defined in Constants.cpp at runtime
+ *
+ * The values are taken from the following sources, each one overriding
+ * the previous ones:
+ * 1. the named preset: fast, balanced (the defaults) or exact
+ * 2. the configuration file with lines "NAME = value", # starts a comment
+ * 3. the environment variables PUZZLE_NAME
+ * 4. the definitions NAME=value given on the command line
+ *
+ * All parameters have to be set before the processing starts.
+ */
+namespace Configuration {
+	
+	// one configurable parameter, either integer or real
+	struct Parameter {
+		const char *name;
+		int *integer;
+		double *real;
+		// the smallest allowed value
+		double minimum;
+	};
+	
+#define INTEGER_PARAMETER(name,minimum) { #name, &name, NULL, minimum }
+#define REAL_PARAMETER(name,minimum)    { #name, NULL, &name, minimum }
+	
+	const Parameter PARAMETERS[] = {
+		INTEGER_PARAMETER(NUM_THREADS,1),
+		REAL_PARAMETER(COLOR_FUZZ,0),
+		REAL_PARAMETER(AVG_RECLUSTER_CHANGE,1e-3),
+		INTEGER_PARAMETER(RESOLUTION_DEPTH,1),
+		INTEGER_PARAMETER(BASE_SIZE,1),
+		INTEGER_PARAMETER(TUNING_SAMPLE_SIZE,1),
+		INTEGER_PARAMETER(TUNING_TOP_K,1),
+		REAL_PARAMETER(TUNING_TARGET_RECALL,0),
+		REAL_PARAMETER(SYNTHETIC_PIECE_SIZE,20),
+		REAL_PARAMETER(SYNTHETIC_JITTER,0),
+		REAL_PARAMETER(SYNTHETIC_NOISE,0),
+		INTEGER_PARAMETER(SYNTHETIC_COLORS,0),
+		INTEGER_PARAMETER(SYNTHETIC_SEED,0),
+		REAL_PARAMETER(VISUALIZATION_FRAME,0),
+		REAL_PARAMETER(VISUALIZATION_ERODE,0),
+		REAL_PARAMETER(COLOR_BLUR_RADIUS,0),
+		REAL_PARAMETER(EDGE_TO_COLOR_DISTANCE,1),
+		INTEGER_PARAMETER(MIN_EDGE_SIZE,0),
+		REAL_PARAMETER(MIN_MAX_PIECE_SIZE_RATIO,0),
+		REAL_PARAMETER(MAX_CORNER_ANGLE_DEVIATION,0),
+		REAL_PARAMETER(MAX_CORNER_SIDE_RATIO,1),
+		REAL_PARAMETER(MAX_SILHOUETTE_AREA_DIFFERENCE,0),
+		INTEGER_PARAMETER(SILHOUETTE_SIGNATURE_LENGTH,32),
+		INTEGER_PARAMETER(NUM_SILHOUETTE_POSES,0),
+		INTEGER_PARAMETER(ALIGN_ROTATION_STEP,1),
+		INTEGER_PARAMETER(ALIGN_TRANSLATION_RANGE,0),
+		INTEGER_PARAMETER(ALIGN_TRANSLATION_STEP,1),
+		INTEGER_PARAMETER(ALIGN_ITERATIONS,1),
+		INTEGER_PARAMETER(ALIGN_COARSE_STEP,1),
+		INTEGER_PARAMETER(ALIGN_COARSE_ITERATIONS,1),
+		INTEGER_PARAMETER(ALIGN_NUM_REFINED,1),
+		REAL_PARAMETER(ALIGN_ABANDON_RATIO,0),
+		INTEGER_PARAMETER(PAIR_SEARCH_WINDOW,1),
+		REAL_PARAMETER(SHAPE_WEIGHT,0),
+		REAL_PARAMETER(HUE_WEIGHT,0),
+		REAL_PARAMETER(SATURATION_WEIGHT,0),
+		REAL_PARAMETER(LUMINOSITY_WEIGHT,0)
+	};
+	
+#undef INTEGER_PARAMETER
+#undef REAL_PARAMETER
+	
+	const int NUM_PARAMETERS = sizeof(PARAMETERS) / sizeof(PARAMETERS[0]);
+	
+	// value of one parameter in a named preset
+	struct PresetValue {
+		const char *preset, *name, *value;
+	};
+	
+	// the balanced preset keeps the defaults
+	const PresetValue PRESETS[] = {
+		// fewer starting transformations, coarser alignments and a deeper cascade,
+		// so fewer edges reach the full resolution
+		{ "fast", "RESOLUTION_DEPTH", "4" },
+		{ "fast", "BASE_SIZE", "10" },
+		{ "fast", "ALIGN_ROTATION_STEP", "10" },
+		{ "fast", "ALIGN_TRANSLATION_STEP", "6" },
+		{ "fast", "ALIGN_ITERATIONS", "6" },
+		{ "fast", "ALIGN_COARSE_STEP", "6" },
+		{ "fast", "ALIGN_COARSE_ITERATIONS", "3" },
+		{ "fast", "ALIGN_NUM_REFINED", "2" },
+		{ "fast", "NUM_SILHOUETTE_POSES", "2" },
+		{ "fast", "PAIR_SEARCH_WINDOW", "3" },
+		// denser search everywhere and a shallower cascade keeping more edges
+		// for the full resolution
+		{ "exact", "RESOLUTION_DEPTH", "2" },
+		{ "exact", "BASE_SIZE", "100" },
+		{ "exact", "ALIGN_ROTATION_STEP", "2" },
+		{ "exact", "ALIGN_TRANSLATION_STEP", "2" },
+		{ "exact", "ALIGN_ITERATIONS", "15" },
+		{ "exact", "ALIGN_COARSE_STEP", "2" },
+		{ "exact", "ALIGN_COARSE_ITERATIONS", "8" },
+		{ "exact", "ALIGN_NUM_REFINED", "6" },
+		{ "exact", "ALIGN_ABANDON_RATIO", "0.3" },
+		{ "exact", "NUM_SILHOUETTE_POSES", "5" },
+		{ "exact", "PAIR_SEARCH_WINDOW", "8" }
+	};
+	
+	const int NUM_PRESET_VALUES = sizeof(PRESETS) / sizeof(PRESETS[0]);
+	
+	// removes the white space from both ends of the string
+	string trim(const string &s) {
+		size_t begin = s.find_first_not_of(" \t\r\n");
+		if (begin == string::npos) return "";
+		size_t end = s.find_last_not_of(" \t\r\n");
+		return s.substr(begin,end-begin+1);
+	}
+	
+	// finds the parameter of given name
+	const Parameter& parameter(const string &name) {
+		for (int i = 0; i < NUM_PARAMETERS; i++) {
+			if (name == PARAMETERS[i].name)
+				return PARAMETERS[i];
+		}
+		throw "unknown configuration parameter";
+	}
+	
+	// sets the parameter of given name to the value given as a string
+	void set(const string &name, const string &value) {
+		const Parameter &p = parameter(name);
+		istringstream in(value);
+		double number;
+		if (!(in >> number) || !(in >> ws).eof())
+			throw "bad value of configuration parameter";
+		if (number < p.minimum)
+			throw "configuration parameter out of range";
+		if (p.integer != NULL) {
+			if (number != floor(number))
+				throw "configuration parameter has to be integer";
+			*p.integer = int(number);
+		} else {
+			*p.real = number;
+		}
+	}
+	
+	// sets the parameter from the definition NAME=value
+	void define(const string &definition) {
+		size_t equals = definition.find('=');
+		if (equals == string::npos)
+			throw "bad configuration definition";
+		set(trim(definition.substr(0,equals)),trim(definition.substr(equals+1)));
+	}
+	
+	// sets all parameters defined by the named preset
+	void applyPreset(const string &preset) {
+		if (preset != "fast" && preset != "balanced" && preset != "exact")
+			throw "unknown configuration preset";
+		for (int i = 0; i < NUM_PRESET_VALUES; i++) {
+			if (preset == PRESETS[i].preset)
+				set(PRESETS[i].name,PRESETS[i].value);
+		}
+	}
+	
+	// sets the parameters defined in the configuration file
+	void loadFile(const string &fileName) {
+		ifstream file(fileName.c_str());
+		if (!file)
+			throw "cannot open configuration file";
+		string line;
+		while (getline(file,line)) {
+			line = trim(line.substr(0,line.find('#')));
+			if (!line.empty())
+				define(line);
+		}
+	}
+	
+	// sets the parameters defined by the environment variables PUZZLE_NAME
+	void loadEnvironment() {
+		for (int i = 0; i < NUM_PARAMETERS; i++) {
+			const char *value = getenv((string("PUZZLE_") + PARAMETERS[i].name).c_str());
+			if (value != NULL)
+				set(PARAMETERS[i].name,value);
+		}
+	}
+	
+	// returns the values of all parameters as lines NAME=value,
+	// they are recorded together with the results
+	string describe() {
+		ostringstream out;
+		for (int i = 0; i < NUM_PARAMETERS; i++) {
+			out << PARAMETERS[i].name << '=';
+			if (PARAMETERS[i].integer != NULL)
+				out << *PARAMETERS[i].integer;
+			else
+				out << *PARAMETERS[i].real;
+			out << endl;
+		}
+		return out.str();
+	}
+	
+};
@@ -1,44 +1,109 @@
 /**
  * Settings of the method described in thesis
+ *
+ * The values are the defaults of the balanced preset, all of them can be
+ * changed at runtime through Configuration before the processing starts.
  */
 
 // num of parallel execution threads
-const int NUM_THREADS = 1;
+int NUM_THREADS = 1;
 
 // the threshold distance from the average coloour of the background to be considered foreground
-const double COLOR_FUZZ = 20.0;
+double COLOR_FUZZ = 20.0;
 
 // the minimal average change of the cluster means until they are considered converged
-const double AVG_RECLUSTER_CHANGE = 1.0;
+double AVG_RECLUSTER_CHANGE = 1.0;
 
-// number of versions in lower resolutions for every edge
-const int RESOLUTION_DEPTH = 3;
+// number of levels of the cascade, the versions in lower resolutions
+// for every edge and the edge itself
+int RESOLUTION_DEPTH = 3;
 
 // number of best edges for which is computed the optimal geometric layout in the full resolution
-const int BASE_SIZE = 50;
+int BASE_SIZE = 50;
+
+// number of rows of the compatibility table computed to tune the cascade
+int TUNING_SAMPLE_SIZE = 64;
+
+// the tuned cascade has to find this fraction of the TUNING_TOP_K best edges
+// found in the full resolution
+int TUNING_TOP_K = 5;
+double TUNING_TARGET_RECALL = 0.95;
+
+// synthetic puzzles generated instead of the scans for the scaling tests
+// - the length of the side of a piece in pixels
+double SYNTHETIC_PIECE_SIZE = 100.0;
+// - the deviation of the positions of the corners of the grid in pixels,
+//   at most 0.1 of the piece size
+double SYNTHETIC_JITTER = 5.0;
+// - the deviation of the noise of every point of the edges in pixels,
+//   at most 0.02 of the piece size
+double SYNTHETIC_NOISE = 0.5;
+// - non-zero to colour the puzzle by gradients, otherwise it is gray
+int SYNTHETIC_COLORS = 1;
+int SYNTHETIC_SEED = 1;
 
 // the frame arounf the solved puzzle in pixels
-const double VISUALIZATION_FRAME = 30;
+double VISUALIZATION_FRAME = 30;
 
 // erosion of the pieces in the visualized solution
 // - makes an aisle between the pieces
-const double VISUALIZATION_ERODE = 2.0;
+double VISUALIZATION_ERODE = 2.0;
 
 // blur of images used during extraction of the colour
-const double COLOR_BLUR_RADIUS = 2.0;
+double COLOR_BLUR_RADIUS = 2.0;
 
 // the distance from the edge in which is extracted color for every point
-const double EDGE_TO_COLOR_DISTANCE = 6.0;
+double EDGE_TO_COLOR_DISTANCE = 6.0;
 
 // the minimal length of th edge in pixels
-const int MIN_EDGE_SIZE = 30;
+int MIN_EDGE_SIZE = 30;
+
+double MIN_MAX_PIECE_SIZE_RATIO = 0.25;
+
+// the maximal deviation of the angle in the corner of the piece from the right angle in degrees
+double MAX_CORNER_ANGLE_DEVIATION = 45.0;
+
+// the maximal ratio of the longest and the shortest side of the quadrilateral given by the corners
+double MAX_CORNER_SIDE_RATIO = 3.0;
+
+// the maximal relative difference of areas of the shape and its silhouette
+// - larger difference means the silhouette is merged with other pieces or broken
+double MAX_SILHOUETTE_AREA_DIFFERENCE = 0.2;
+
+// number of samples of the signatures compared by SilhouetteMatcher
+int SILHOUETTE_SIGNATURE_LENGTH = 128;
+
+// number of the poses estimated from the silhouette used as starting transformations
+int NUM_SILHOUETTE_POSES = 3;
+
+// the step in degrees of the starting rotations of the shape matched to the front scan
+// when its silhouette is not usable
+int ALIGN_ROTATION_STEP = 5;
+
+// the range and the step in pixels of the starting translations of the best match
+int ALIGN_TRANSLATION_RANGE = 6;
+int ALIGN_TRANSLATION_STEP = 3;
+
+// number of iterations matching the shape to the edges in the full resolution
+int ALIGN_ITERATIONS = 10;
+
+// subsampling of the shape and number of iterations used to score the starting transformations
+int ALIGN_COARSE_STEP = 4;
+int ALIGN_COARSE_ITERATIONS = 5;
+
+// number of the best starting transformations refined in the full resolution
+int ALIGN_NUM_REFINED = 3;
+
+// starting transformations scoring below this fraction of the kept ones are abandoned early
+double ALIGN_ABANDON_RATIO = 0.5;
 
-const double MIN_MAX_PIECE_SIZE_RATIO = 0.25;
+// how far along the second edge the matching point of a point on the first edge is searched
+int PAIR_SEARCH_WINDOW = 5;
 
 // weights of elementary scores in the final compatibility score
 // configured for shape-only information, for using the colour define the parameters as mentioned int hesis
-const double SHAPE_WEIGHT = 1.0;
-const double HUE_WEIGHT = 0.0;
-const double SATURATION_WEIGHT = 0.0;
-const double LUMINOSITY_WEIGHT = 0.0;
+double SHAPE_WEIGHT = 1.0;
+double HUE_WEIGHT = 0.0;
+double SATURATION_WEIGHT = 0.0;
+double LUMINOSITY_WEIGHT = 0.0;
 
@@ -1,6 +1,10 @@
 class BinaryObjectExtractor {
 	
-	Image image;
+	// value component of the scanned image
+	PlanarImage::Plane value;
+	int columns, rows;
+	// binarised image, foreground are the puzzle pieces
+	Bitmap bitmap;
 	
 	// computes the weighted sum S[i] = sum{j * W[j] | j < i}
 	static vector<int> partialWeightedSums(vector<int> histogram) {
@@ -16,17 +20,7 @@ class BinaryObjectExtractor {
 	
 	// creates a histogram of the image
 	vector<int> grayscaleHistogram(int numLevels = 256) {
-		vector<int> histogram(numLevels);
-		int rows = image.rows();
-		int columns = image.columns();
-		const PixelPacket* pixels = image.getConstPixels(0,0,columns,rows);
-		for (int y = 0; y < rows; y++) {
-			for (int x = 0; x < columns; x++) {
-				double value = ColorGray(*pixels++).shade();
-				histogram[int(value * (numLevels-1))]++;
-			}
-		}
-		return histogram;
+		return PlanarImage::histogram(value,numLevels);
 	}
 	
 	// finds the optimal threshold for the segmentation of pieces
@@ -45,14 +39,16 @@ class BinaryObjectExtractor {
 	}
 	
 	// binarizing the image into bright foreground (puzzle pieces) and dark background
-	void binarize() {
+	void binarize(const PlanarImage &image) {
 		// transform to grayscale
-		image = ImageValue(image);
+		value = image.value();
+		columns = image.columns();
+		rows = image.rows();
 		// binarize
-		image.threshold(findThreshold());
+		bitmap = PlanarImage::threshold(value,columns,rows,findThreshold());
 		// suppress noise
-		MorphologicProcessor processor(image);
-		image = processor.smooth(2);
+		MorphologicProcessor processor(bitmap);
+		bitmap = processor.smooth(2);
 	}
 	
 	// filter out the components having the area size less than the given ratio of the greatest component size
@@ -73,29 +69,15 @@ class BinaryObjectExtractor {
 	
 	public:
 	
-	// transforms the image into grayscale replacing the value of each pixels with
-	// maximum of its red, green and blue component
-	static Image ImageValue(Image image) {
-		int rows = image.rows();
-		int columns = image.columns();
-		PixelPacket* pixels = image.getPixels(0,0,columns,rows);
-		for (int i = 0; i < rows*columns; i++) {
-			ColorRGB c(*pixels);
-			*pixels++ = ColorGray(max(c.red(),max(c.green(),c.blue())));
-		}
-		image.syncPixels();
-		return image;
-	}
-	
 	// initializes the extractor with given image of the pices scanned from the back side
-	BinaryObjectExtractor(string fileName) 
-		: image(fileName) {
-		binarize();
+	BinaryObjectExtractor(string fileName) {
+		Image image(fileName);
+		binarize(PlanarImage(image));
 	}
 	
 	// returns all bright components defined by their shape in the counterclockwise order
 	Shapes extractShapes() {
-		ComponentExtractor extractor(image);
+		ComponentExtractor extractor(bitmap);
 		Shapes shapes = extractor.extractComponents();
 		
 		return deleteSmallComponents(shapes,MIN_MAX_PIECE_SIZE_RATIO);
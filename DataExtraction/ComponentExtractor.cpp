@@ -1,84 +1,189 @@
 /**
  * Component extractor extracts from the given binarised image
  * all components having foreground colour.
- * 
+ *
  * Usage:
  * 1. initialise the instance with an image, where the background has
- *    black colour and the foreground white colour.
+ *    black colour and the foreground white colour (or with a Bitmap).
  * 2. calling of extractComponents() returns all connected foreground components
  *    represented by the sequences of pixels. Each sequence definines one component
  *    as a sequence of pixels along its border in counter-clockwise order.
+ *
+ * The components are labelled in two passes over the bitmap using union-find
+ * and then their borders are traced in parallel on the labelled pixels.
  */
 
-class ComponentExtractor {
-	
-	Image image;
-	
+// traces the border of one labelled component
+class ContourTracer {
+
+	// order of the component of each pixel or -1 for background
+	const Array2D<int> *labels;
+	int component;
+	IntegerPoint start;
+	Shape shape;
+
 	// determines if given point is a border pixel of the foreground component
-	// e.g. coincides with at least one white pixel.
+	// e.g. coincides with at least one foreground pixel.
+	// The point p is a corner shared by pixels p-(1,1) ... p, components extracted
+	// earlier are not visible as they would be already erased.
 	inline bool IsShapePixel(IntegerPoint p) const {
-		const PixelPacket* pixels = image.getConstPixels(p.x-1,p.y-1,2,2);
-		for (int i = 0; i < 4; i++) {
-			if (ColorMono(*pixels++).mono()) {
-				return true;
+		for (int y = p.y-1; y <= p.y; y++) {
+			for (int x = p.x-1; x <= p.x; x++) {
+				if (labels->valid(x,y) && labels->at(x,y) >= component)
+					return true;
 			}
 		}
 		return false;
 	}
-	
-	// returns the sequence of pixels around one component starting in the given point
-	// the starting point has to be on the border of the component
-	// = IsShapePixel(start) returns true
-	Shape TraceComponent(const IntegerPoint start) {
-		Shape shape;
-		
+
+	public:
+
+	// the starting point has to be the first pixel of the component in the row-major order
+	ContourTracer(const Array2D<int> *labels, int component, IntegerPoint start)
+		: labels(labels), component(component), start(start) {
+	}
+
+	// computes the sequence of pixels around the component
+	void trace() {
+		shape.clear();
+
 		int dir = 2;
 		IntegerPoint p = start;
-		
+
 		do {
 			using Utils::Direction;
-			shape.push_back(Utils::convert(p)-RealPoint(2.5,2.5));
+			shape.push_back(Utils::convert(p)-RealPoint(0.5,0.5));
 			dir = (dir+1)%4;
 			while (!IsShapePixel(p+Direction[dir]))
 				dir = (dir+3)%4;
 			p += Direction[dir];
 		} while (p != start);
-		
+	}
+
+	const Shape& getShape() const {
 		return shape;
 	}
-	
+
+};
+
+class ComponentExtractor {
+
+	Bitmap bitmap;
+	// order of the component of each pixel or -1 for background
+	Array2D<int> labels;
+
+	// representative of the set in the union-find structure
+	static int findRoot(vector<int> &parent, int label) {
+		int root = label;
+		while (parent[root] != root)
+			root = parent[root];
+		// compress the path
+		while (parent[label] != root) {
+			int next = parent[label];
+			parent[label] = root;
+			label = next;
+		}
+		return root;
+	}
+
+	// joins two sets, the smaller label (created earlier) becomes the representative
+	static int join(vector<int> &parent, int label1, int label2) {
+		label1 = findRoot(parent,label1);
+		label2 = findRoot(parent,label2);
+		if (label1 > label2) swap(label1,label2);
+		parent[label2] = label1;
+		return label1;
+	}
+
+	// labels 8-connected components and returns the first pixel of each of them,
+	// components are ordered by their first pixel in the row-major order
+	IntegerPoints labelComponents() {
+		int columns = bitmap.columns();
+		int rows = bitmap.rows();
+		labels.resize(bitmap.size());
+
+		// first pass assigns provisional labels and records their equivalence
+		vector<int> parent;
+		IntegerPoints firstPixel;
+		for (int y = 0; y < rows; y++) {
+			for (int x = 0; x < columns; x++) {
+				if (!bitmap.get(x,y)) {
+					labels.at(x,y) = -1;
+					continue;
+				}
+				int label = -1;
+				// already visited neighbours: W, NW, N, NE
+				const int dx[4] = { -1, -1, 0, +1 };
+				const int dy[4] = {  0, -1, -1, -1 };
+				for (int k = 0; k < 4; k++) {
+					int nx = x+dx[k], ny = y+dy[k];
+					if (!labels.valid(nx,ny) || labels.at(nx,ny) < 0)
+						continue;
+					if (label < 0)
+						label = findRoot(parent,labels.at(nx,ny));
+					else
+						label = join(parent,label,labels.at(nx,ny));
+				}
+				if (label < 0) {
+					label = parent.size();
+					parent.push_back(label);
+					firstPixel.push_back(IntegerPoint(x,y));
+				}
+				labels.at(x,y) = label;
+			}
+		}
+
+		// representatives are the labels created first, so numbering them
+		// in increasing order follows the order of first pixels
+		int numLabels = parent.size();
+		vector<int> order(numLabels,-1);
+		IntegerPoints starts;
+		for (int i = 0; i < numLabels; i++) {
+			if (findRoot(parent,i) == i) {
+				order[i] = starts.size();
+				starts.push_back(firstPixel[i]);
+			}
+		}
+
+		// second pass replaces provisional labels by the order of the component
+		for (int y = 0; y < rows; y++) {
+			for (int x = 0; x < columns; x++) {
+				int &label = labels.at(x,y);
+				if (label >= 0)
+					label = order[findRoot(parent,label)];
+			}
+		}
+		return starts;
+	}
+
 	public:
-	
+
 	// initializes the instance with given binarised image
 	ComponentExtractor(const Image &image)
-		: image(image) {
+		: bitmap(image) {
+	}
+
+	// initializes the instance with given bitmap
+	ComponentExtractor(const Bitmap &bitmap)
+		: bitmap(bitmap) {
 	}
-	
+
 	// extract all components from the initialised image
-	// note. this call is allowed only once, each following call returns empty set
 	vector<Shape> extractComponents() {
+		IntegerPoints starts = labelComponents();
+
+		vector<ContourTracer> tracers;
+		for (unsigned int i = 0; i < starts.size(); i++) {
+			tracers.push_back(ContourTracer(&labels,i,starts[i]));
+		}
+		// components are independent, trace them in parallel
+		Parallel::ForEach(tracers,&ContourTracer::trace);
+
 		vector<Shape> components;
-		
-		// intend to ensure there are no shape pixels directly on the border
-		image.borderColor(ColorMono(false));
-		image.border("2x2");
-		
-		int columns  = image.columns();
-		int rows = image.rows();
-		
-		// iterate the image and extract the components
-		const PixelPacket* pixels = image.getPixels(0,0,columns,rows);
-		for (int y = 0; y < rows; y++) {
-			for (int x = 0; x < columns; x++) {
-				if (ColorMono(*pixels++).mono()) {
-					cout << '.';
-					components.push_back(TraceComponent(IntegerPoint(x,y)));
-					image.floodFillColor(x,y,"black");
-				}
-			}
+		for (unsigned int i = 0; i < tracers.size(); i++) {
+			components.push_back(tracers[i].getShape());
 		}
-		
 		return components;
 	}
-	
+
 };
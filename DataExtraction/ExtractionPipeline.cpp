@@ -6,7 +6,7 @@
  * Usage:
  * 1. initialize instance with filename of front and connecred back scan image.
  * 2. call extractPieces() to run the extraction process.
- * 3. call getPieces() to get the extracted pieces
+ * 3. call getStore() to get the store of the extracted pieces
  *
  * For the best performance on paralell systems it is desired to create a vector
  * of instances - for each pair of images one. Next call of Parallel::Map() on this
@@ -15,9 +15,11 @@
 class ExtractionPipeline {
 	// filenames of the front and the connected back scan
 	string frontImage, backImage;
-	Pieces pieces;
+	// extracted pieces, numbered from zero
+	PieceStore store;
 	
 	Shapes pieceBackShapes() {
+		Trace::Span span("ExtractionPipeline::pieceBackShapes");
 		BinaryObjectExtractor extractor(backImage);
 		return extractor.extractShapes();
 	}
@@ -26,23 +28,63 @@ class ExtractionPipeline {
 		return MAP1(RealPoint,Geometry2D::centerOfPolygon,backShapes);
 	}
 	
-	RealPoints piecePositions(const RealPoints &expPositions) {
+	// detects the positions of pieces and their silhouettes on the front scan
+	RealPoints piecePositions(const RealPoints &expPositions, Shapes &silhouettes) {
+		Trace::Span span("ExtractionPipeline::piecePositions");
 		ObjectDetector detector(frontImage);
-		return detector.detectObjectPositions(expPositions);
+		RealPoints positions = detector.detectObjectPositions(expPositions);
+		silhouettes = detector.detectObjectSilhouettes(positions);
+		return positions;
 	}
 	
 	Shapes flipShapes(const Shapes &shapes) {
 		return MAP1(Shape,ShapeUtils::flipShape,shapes);
 	}
 	
-	Shapes pieceShapes(const RealPoints &positions, const Shapes &frontShapes) {
-		PatternAlignOptimizer optimizer(frontImage);
-		return MAP2(Shape,optimizer.optimizeAlign,frontShapes,positions);
+	// the largest distance of a point of some shape from the center of the shape
+	double maxShapeRadius(const Shapes &shapes) {
+		double radius = 0.0;
+		for (unsigned int i = 0; i < shapes.size(); i++) {
+			RealPoint center = Geometry2D::centerOfPolygon(shapes[i]);
+			for (unsigned int j = 0; j < shapes[i].size(); j++) {
+				radius = max(radius,(shapes[i][j]-center).length());
+			}
+		}
+		return radius;
 	}
 	
-	Pieces extractPieces(const Shapes &shapes) {
+	Shapes pieceShapes(const RealPoints &positions, const Shapes &silhouettes, const Shapes &frontShapes) {
+		Trace::Span span("ExtractionPipeline::pieceShapes");
+		PatternAlignOptimizer optimizer(Image(frontImage),positions,maxShapeRadius(frontShapes));
+		Shapes shapes;
+		for (unsigned int i = 0; i < frontShapes.size(); i++) {
+			shapes.push_back(optimizer.optimizeAlign(frontShapes[i],positions[i],silhouettes[i]));
+		}
+		return shapes;
+	}
+	
+	// identifies the corners of all shapes in parallel, the corners are
+	// identified on the shapes as viewed from the back side
+	vector<Quadruplet> pieceCorners(const Shapes &shapes) {
+		Trace::Span span("ExtractionPipeline::pieceCorners");
+		vector<CornerIdentifier> identifiers;
+		for (unsigned int i = 0; i < shapes.size(); i++) {
+			identifiers.push_back(CornerIdentifier(ShapeUtils::flipShape(shapes[i])));
+		}
+		Parallel::ForEach(identifiers,&CornerIdentifier::identify);
+		vector<Quadruplet> corners;
+		for (unsigned int i = 0; i < identifiers.size(); i++) {
+			corners.push_back(identifiers[i].getCorners());
+		}
+		return corners;
+	}
+	
+	void extractPieces(const Shapes &shapes, const vector<Quadruplet> &corners) {
+		Trace::Span span("ExtractionPipeline::extractPieces");
 		PieceExtractor extractor(frontImage);
-		return MAP1(PieceRef,extractor.extractPiece,shapes);
+		for (unsigned int i = 0; i < shapes.size(); i++) {
+			extractor.extractPiece(shapes[i],corners[i],store);
+		}
 	}
 	
 	public:
@@ -60,18 +102,21 @@ class ExtractionPipeline {
 		// of piece on the front scan
 		RealPoints expPositions = expectedFrontPositions(backShapes);
 		// find the real positions of pieces on the front scan based on
-		// expected positions
-		RealPoints positions    = piecePositions(expPositions);
+		// expected positions, together with their silhouettes
+		Shapes silhouettes;
+		RealPoints positions    = piecePositions(expPositions,silhouettes);
 		// for each shape compute the transformation to exactly match the
 		// desired piece
-		Shapes shapes           = pieceShapes(positions,frontShapes);
+		Shapes shapes           = pieceShapes(positions,silhouettes,frontShapes);
+		// find the four corners of each shape
+		vector<Quadruplet> corners = pieceCorners(shapes);
 		// segment pieces from the front scan based on their shape
-		pieces = extractPieces(shapes);
+		extractPieces(shapes,corners);
 	}
 	
-	// return extracted pieces
-	Pieces getPieces() {
-		return pieces;
-	} 
+	// return the store of extracted pieces
+	PieceStore& getStore() {
+		return store;
+	}
 	
 };
@@ -1,60 +1,198 @@
 /**
  * Object detector computes the positions of pieces on the given front scan image
  * based on their expected positions.
- * 
+ *
  * Usage:
  * 1. Initialize the instance with name of image of front scan of pieces together
  * with their expected positions on image.
  * 2. run detectObjectPositions with itinial means to obtain the centers of detected objects.
- * 
+ *
  * The process of positions computation is sequence of several steps:
- * 1. Binarize the given image to background and foreground (pieces)
+ * 1. Binarize the given image to background and foreground (pixels of pieces)
  * 2. Run K-means clustering to determine for reach pixel of foreground
  *    his incidence to one puzzle piece.
  * 3. Compute center (of mass) for each group of pixels forming one piece
+ *
+ * The silhouettes of the pieces can be obtained by detectObjectSilhouettes.
+ *
+ * The clustering first converges on a subsampled image and then is refined
+ * in the full resolution.
  */
+
+// assigns the foreground pixels in a band of rows to the closest cluster means
+// and sums the assigned points for each cluster
+class ClusterAssigner {
+
+	// size of the square block of pixels sharing the set of candidate means
+	static const int BLOCK_SIZE = Bitmap::WORD_BITS;
+
+	const Bitmap *bitmap;
+	const RealPoints *means;
+	int firstRow, lastRow;
+
+	vector<RealPoint> sumPoints;
+	vector<int> numPoints;
+
+	// squared distance of the point to the closest and to the farthest point of the block
+	static pair<double,double> blockDistances(RealPoint p, RealPoint from, RealPoint to) {
+		double dx = max(0.0,max(from.x-p.x,p.x-to.x));
+		double dy = max(0.0,max(from.y-p.y,p.y-to.y));
+		double fx = max(abs(p.x-from.x),abs(p.x-to.x));
+		double fy = max(abs(p.y-from.y),abs(p.y-to.y));
+		return make_pair(dx*dx+dy*dy,fx*fx+fy*fy);
+	}
+
+	// returns the means which can be the closest one for some pixel in the block
+	// - the mean is excluded if it is farther from the whole block than other mean
+	// from the farthest point of the block
+	vector<int> candidateMeans(RealPoint from, RealPoint to) const {
+		int numClusters = means->size();
+		vector< pair<double,double> > distances(numClusters);
+		double bound = Utils::DOUBLE_INF;
+		for (int i = 0; i < numClusters; i++) {
+			distances[i] = blockDistances((*means)[i],from,to);
+			bound = min(bound,distances[i].second);
+		}
+		vector<int> candidates;
+		for (int i = 0; i < numClusters; i++) {
+			if (distances[i].first <= bound)
+				candidates.push_back(i);
+		}
+		return candidates;
+	}
+
+	// adds all foreground pixels of the word to the single cluster
+	void addWord(Bitmap::Word word, int x0, int y, int cluster) {
+		while (word) {
+			int bit = __builtin_ctzll(word);
+			sumPoints[cluster] += RealPoint(x0+bit,y);
+			numPoints[cluster] += 1;
+			word &= word-1;
+		}
+	}
+
+	// adds each foreground pixel of the word to the closest of the candidate clusters
+	void addWord(Bitmap::Word word, int x0, int y, const vector<int> &candidates) {
+		while (word) {
+			int bit = __builtin_ctzll(word);
+			RealPoint p(x0+bit,y);
+			int nearest = candidates[0];
+			double nearestDist = (p-(*means)[nearest]).squareLength();
+			for (unsigned int i = 1; i < candidates.size(); i++) {
+				double dist = (p-(*means)[candidates[i]]).squareLength();
+				if (dist < nearestDist)
+					nearestDist = dist, nearest = candidates[i];
+			}
+			sumPoints[nearest] += p;
+			numPoints[nearest] += 1;
+			word &= word-1;
+		}
+	}
+
+	// assigns the pixels of one block
+	void assignBlock(int column, int top) {
+		int bottom = min(top+BLOCK_SIZE,lastRow);
+		bool empty = true;
+		for (int y = top; y < bottom && empty; y++) {
+			empty = bitmap->row(y)[column] == 0;
+		}
+		if (empty) return;
+
+		int x0 = column*BLOCK_SIZE;
+		RealPoint from(x0,top), to(x0+BLOCK_SIZE-1,bottom-1);
+		vector<int> candidates = candidateMeans(from,to);
+		for (int y = top; y < bottom; y++) {
+			Bitmap::Word word = bitmap->row(y)[column];
+			if (candidates.size() == 1)
+				addWord(word,x0,y,candidates[0]);
+			else
+				addWord(word,x0,y,candidates);
+		}
+	}
+
+	public:
+
+	ClusterAssigner(const Bitmap *bitmap, const RealPoints *means, int firstRow, int lastRow)
+		: bitmap(bitmap), means(means), firstRow(firstRow), lastRow(lastRow) {
+	}
+
+	// assigns all pixels in the band
+	void assign() {
+		sumPoints.assign(means->size(),RealPoint());
+		numPoints.assign(means->size(),0);
+		for (int top = firstRow; top < lastRow; top += BLOCK_SIZE) {
+			for (int column = 0; column < bitmap->wordsPerRow(); column++) {
+				assignBlock(column,top);
+			}
+		}
+	}
+
+	const vector<RealPoint>& getSumPoints() const {
+		return sumPoints;
+	}
+
+	const vector<int>& getNumPoints() const {
+		return numPoints;
+	}
+
+};
+
 class ObjectDetector {
-	
-	Image image;
-	
+
+	// factor of subsampling of the image in the first phase of the clustering
+	static const int SUBSAMPLE_FACTOR = 4;
+
+	// binarised front scan, foreground are pixels of pieces
+	Bitmap bitmap;
+	// subsampled version of the binarised scan
+	Bitmap coarseBitmap;
+
 	// run one iteration of the K-means clustering on the binarised image
 	// e.g. determine the centers of clusters given by given points
-	RealPoints recluster(RealPoints means) const {
+	static RealPoints recluster(const Bitmap &bitmap, RealPoints means) {
 		int numClusters = means.size();
-		int rows    = image.rows();
-		int columns = image.columns();
-		
+		int rows = bitmap.rows();
+
+		// split the rows into bands processed in parallel, the bands are aligned
+		// to the blocks of ClusterAssigner
+		int bandSize = (rows+NUM_THREADS-1) / NUM_THREADS;
+		bandSize = (bandSize+Bitmap::WORD_BITS-1) / Bitmap::WORD_BITS * Bitmap::WORD_BITS;
+		vector<ClusterAssigner> assigners;
+		for (int top = 0; top < rows; top += bandSize) {
+			assigners.push_back(ClusterAssigner(&bitmap,&means,top,min(top+bandSize,rows)));
+		}
+		Parallel::ForEach(assigners,&ClusterAssigner::assign);
+
+		// reduce the partial sums
 		vector<RealPoint> sumPoints(numClusters);
 		vector<int> numPoints(numClusters);
-		
-		const PixelPacket* pixels = image.getConstPixels(0,0,columns,rows);
-		for (int y = 0; y < rows; y++) {
-			for (int x = 0; x < columns; x++) {
-				if (ColorMono(*pixels++).mono()) {
-					RealPoint p(x,y);
-					int nearest = Geometry2D::closestPoint(p,means);
-					sumPoints[nearest] += p;
-					numPoints[nearest] += 1;
-				}
+		for (unsigned int k = 0; k < assigners.size(); k++) {
+			for (int i = 0; i < numClusters; i++) {
+				sumPoints[i] += assigners[k].getSumPoints()[i];
+				numPoints[i] += assigners[k].getNumPoints()[i];
 			}
 		}
-		
+
 		for (int i = 0; i < numClusters; i++) {
-			means[i] = sumPoints[i] / numPoints[i];
+			// empty cluster keeps its mean
+			if (numPoints[i] > 0)
+				means[i] = sumPoints[i] / numPoints[i];
 		}
 		return means;
 	}
-	
+
 	// binarizes front scan into foreground (pixels of pieces) and background
 	// using the realtive colour distance from the background colour.
-	void binarize() {
+	void binarize(Image image) {
 		image.colorFuzz(COLOR_FUZZ);
 		image.floodFillColor(20,20,"black");
 		image.threshold(1.0); // monochrome
+		bitmap = Bitmap(image);
+		coarseBitmap = bitmap.subsample(SUBSAMPLE_FACTOR);
 	}
-	
+
 	// computes the squared distances of two sets of points
-	double squareDifference(RealPoints &v1, RealPoints &v2) const {
+	static double squareDifference(RealPoints &v1, RealPoints &v2) {
 		double sum = 0.0;
 		int length = v1.size();
 		for (int i = 0; i < length; i++) {
@@ -62,26 +200,70 @@ class ObjectDetector {
 		}
 		return sum / length;
 	}
+
+	// multiplies the coordinates of all points by given scale
+	static RealPoints scalePoints(RealPoints points, double scale) {
+		for (unsigned int i = 0; i < points.size(); i++) {
+			const RealPoint &p = points[i];
+			points[i] = p * scale;
+		}
+		return points;
+	}
 	
+	// iteratively reclusterize the binarised image until the clusters are changing
+	static RealPoints cluster(const Bitmap &bitmap, RealPoints positions, double minChange) {
+		RealPoints oldPos;
+		do {
+			oldPos = positions;
+			positions = recluster(bitmap,positions);
+			Metrics::count(Metrics::KMEANS_ITERATIONS);
+		} while (squareDifference(oldPos,positions) >= minChange);
+		return positions;
+	}
+
 	public:
-	
+
 	// initializes an instance with the name of processed image
-	ObjectDetector(string fileName)
-		: image(fileName) {
-		binarize();
+	ObjectDetector(string fileName) {
+		binarize(Image(fileName));
 	}
-	
+
 	// runs the clusterization of the image with given set of initial means
 	// returns the final means
 	RealPoints detectObjectPositions(RealPoints positions) const {
-		RealPoints oldPos;
-		// iteratively reclusterize binarized image
-		// until the found clusters are changing
-		do {
-			oldPos = positions;
-			positions = recluster(positions);
-		} while (squareDifference(oldPos,positions) < AVG_RECLUSTER_CHANGE);
-		return positions;
+		const double scale = SUBSAMPLE_FACTOR;
+		// converge on the subsampled image, a change of one pixel there
+		// is a change of scale pixels in the full resolution
+		positions = cluster(coarseBitmap,scalePoints(positions,1/scale),AVG_RECLUSTER_CHANGE/(scale*scale));
+		// refine in the full resolution
+		return cluster(bitmap,scalePoints(positions,scale),AVG_RECLUSTER_CHANGE);
 	}
-	
+
+	// extracts the silhouette of the object closest to each of the given positions
+	// - touching objects share one silhouette, the caller has to check its size
+	Shapes detectObjectSilhouettes(const RealPoints &positions) const {
+		Shapes components = ComponentExtractor(bitmap).extractComponents();
+		// ignore the noise
+		double maxArea = 0.0;
+		for (unsigned int i = 0; i < components.size(); i++) {
+			maxArea = max(maxArea,Geometry2D::areaOfPolygon(components[i]));
+		}
+		Shapes objects;
+		RealPoints centers;
+		for (unsigned int i = 0; i < components.size(); i++) {
+			if (Geometry2D::areaOfPolygon(components[i]) >= MIN_MAX_PIECE_SIZE_RATIO * maxArea) {
+				objects.push_back(components[i]);
+				centers.push_back(Geometry2D::centerOfPolygon(components[i]));
+			}
+		}
+		Shapes silhouettes;
+		for (unsigned int i = 0; i < positions.size(); i++) {
+			if (objects.empty())
+				silhouettes.push_back(Shape());
+			else
+				silhouettes.push_back(objects[ Geometry2D::closestPoint(positions[i],centers) ]);
+		}
+		return silhouettes;
+	}
+
 };
@@ -4,15 +4,20 @@
  * usage:
  * 1. Initialize the PieceExtractor with an image of the pieces scanned from the front side 
  * 2. Each call of extractPiece() with specified location of the piece position on the inmage
- *    by defining its shape will create an instance of one Piece.
+ *    by defining its shape and corners will add one Piece to the given PieceStore.
  */
 
-int edgeCounter;
-int pieceCounter;
-
 class PieceExtractor {
 	
-	Image image;
+	string fileName;
+	// blurred front scan the colours are sampled from
+	PlanarImage image;
+	
+	static Image blurredImage(string fileName) {
+		Image image(fileName);
+		image.blur(COLOR_BLUR_RADIUS);
+		return image;
+	}
 	
 	RealPoint ImageCenter(const Image &image) {
 		return RealPoint(0.5*(image.columns()-1),0.5*(image.rows()-1));
@@ -25,28 +30,43 @@ class PieceExtractor {
 		Geometry geometry = ShapeUtils::boundingBox(shape);
 		RealPoint offset(geometry.xOff(), geometry.yOff());
 		Shape shiftedShape = Geometry2D::translate(shape,-offset);
-		// fill the component defined by the given closed curve into image
-		Image shapeMask = ShapeUtils::shapeMask(geometry,shiftedShape);
+		// fill the component defined by the given closed curve into bitmap
+		Bitmap shapeMask = ShapeUtils::shapeBitmap(geometry.width(),geometry.height(),shiftedShape);
 		MorphologicProcessor processor(shapeMask);
 		// erode the component by given number of pixels
 		// may split the component into several parts
-		Image erodedMask = processor.erode(radius);
+		Bitmap erodedMask = processor.erode(radius);
 		ComponentExtractor extractor(erodedMask);
 		// extract the shape of eroded component
 		Shape erodedShape = Utils::Join(extractor.extractComponents());
-		return Geometry2D::translate(erodedShape,+offset);
+		Geometry2D::translateInPlace(erodedShape,+offset);
+		return erodedShape;
+	}
+	
+	// samples the colours of the blurred image in the given points
+	ColorSignature sampleColors(const Shape &points) const {
+		ColorSignature colors;
+		for (unsigned int i = 0; i < points.size(); i++) {
+			colors.push_back(FixedHSL::fromRGB(
+				image.interpolate(PlanarImage::RED,points[i]) / 255,
+				image.interpolate(PlanarImage::GREEN,points[i]) / 255,
+				image.interpolate(PlanarImage::BLUE,points[i]) / 255
+			));
+		}
+		return colors;
 	}
 	
 	// extracts for each point on the edge the average colour in a constant distance
 	// from this point
-	ColorSignature createColorSignature(Shape shape) const {
+	ColorSignature createColorSignature(const Shape &shape) const {
 		Shape colorPoints = erodeShape(shape,EDGE_TO_COLOR_DISTANCE);
 		Permutation pairs = Geometry2D::closestPoints(shape,colorPoints);
 		
+		// each colour point is sampled only once
+		ColorSignature colors = sampleColors(colorPoints);
 		ColorSignature colorSignature;
 		for (unsigned int i = 0; i < shape.size(); i++) {
-			IntegerPoint p = Utils::convert(colorPoints[pairs[i]]);
-			colorSignature.push_back(image.pixelColor(p.x,p.y));
+			colorSignature.push_back(colors[pairs[i]]);
 		}
 		
 		return colorSignature;
@@ -61,51 +81,32 @@ class PieceExtractor {
 		return center/4;
 	}
 	
-	static int getNewPieceID() {
-		return pieceCounter++;
-	}
-	
-	static int getNewEdgeID() {
-		return edgeCounter++;
-	}
-	
 	public:
 	
 	// initializes an instance with given image of the pieces scanned from the front side
 	PieceExtractor(string fileName)
-		: image(fileName) {
-		image.blur(COLOR_BLUR_RADIUS);
+		: fileName(fileName), image(blurredImage(fileName)) {
 	}
 	
 	// eextract one piece from the image specified by the given shape
-	PieceRef extractPiece(Shape shape) const {
+	// and the indices of its four corners into the store
+	void extractPiece(const Shape &shape, Quadruplet corners, PieceStore &store) const {
 		ColorSignature color = createColorSignature(shape);
-		Quadruplet corners = ShapeAnalysis::IdentifyCorners(ShapeUtils::flipShape(shape));
 		
-		Piece *piece = new Piece;
-		piece->id = PieceExtractor::getNewPieceID();
-		piece->imageName = image.fileName();
-		piece->center = Utils::convert(centerOfPiece(shape,corners));
+		int id = store.addPiece();
+		Piece &piece = store.piece(id);
+		piece.imageName = fileName;
+		piece.center = Utils::convert(centerOfPiece(shape,corners));
 		
-		Edge *edges = new Edge[4];
 		for (int i = 0; i < 4; i++) {
 			int begin = corners[i], end = corners[(i+1)%4];
 			
-			edges[i].id    = PieceExtractor::getNewEdgeID();
-			edges[i].prev  = &edges[(i+3)%4];
-			edges[i].next  = &edges[(i+1)%4];
-			edges[i].piece = piece;
-			edges[i].shape = Geometry2D::translate(
-				SignalProcessor<RealPoint>::interval(shape,begin,end),
-				-Utils::convert(piece->center)
-			);
-			edges[i].color = SignalProcessor<Color>::interval(color,begin,end);
-			edges[i].type  = ShapeAnalysis::shapeScore(edges[i].shape).second;
-			
-			piece->edges[i] = &edges[i];
+			Edge &edge = store.edge(id,i);
+			SignalProcessor<RealPoint>::interval(shape,begin,end,back_inserter(edge.shape));
+			Geometry2D::translateInPlace(edge.shape,-Utils::convert(piece.center));
+			edge.color.assign(SignalProcessor<FixedHSL>::interval(color,begin,end));
+			edge.type  = ShapeAnalysis::shapeScore(edge.shape).second;
 		}
-		
-		return PieceRef(piece);
 	}
 	
 };
@@ -0,0 +1,91 @@
+/**
+ * Piece store owns the pieces and their edges in two contiguous arrays.
+ *
+ * The index of a piece in the store is its id, the piece with id p owns
+ * the edges with ids 4*p .. 4*p+3 in the clockwise order. Every extraction
+ * pipeline fills its own store and the stores are appended together at the end,
+ * so the ids are renumbered densely without any shared counter.
+ *
+ * The samples of the shapes and colours stay in the vectors of every edge.
+ * The rows of the compatibility table are not computed faster with the samples
+ * packed in the order of the ids than with the samples scattered over the heap
+ * (EdgeScores::init microbenchmark), the time is spent aligning the pairs.
+ *
+ * Usage:
+ * 1. addPiece() a new piece and fill it and its edges through piece() and edge()
+ * 2. append() the stores of other pipelines
+ * 3. call getPieces() to obtain the references, they stay valid
+ *    until the store is modified
+ */
+class PieceStore {
+	
+	vector<Piece> pieces;
+	vector<Edge> edges;
+	
+	// sets the ids and the pointers between the pieces and their edges
+	void link() {
+		for (unsigned int p = 0; p < pieces.size(); p++) {
+			pieces[p].id = p;
+			for (int k = 0; k < 4; k++) {
+				Edge &edge = edges[4*p+k];
+				edge.id = 4*p+k;
+				edge.piece = &pieces[p];
+				pieces[p].edges[k] = &edge;
+			}
+		}
+	}
+	
+	public:
+	
+	// adds a new piece with four empty edges and returns its id
+	int addPiece() {
+		pieces.push_back(Piece());
+		edges.resize(edges.size()+4);
+		return pieces.size()-1;
+	}
+	
+	Piece& piece(int id) {
+		return pieces[id];
+	}
+	
+	// k-th edge of the piece with given id in the clockwise order
+	Edge& edge(int id, int k) {
+		return edges[4*id+k];
+	}
+	
+	int size() const {
+		return pieces.size();
+	}
+	
+	// moves all pieces of the other store behind the pieces of this one,
+	// the other store is left empty
+	void append(PieceStore &other) {
+		int offset = pieces.size();
+		pieces.resize(offset+other.pieces.size());
+		edges.resize(4*pieces.size());
+		for (unsigned int p = 0; p < other.pieces.size(); p++) {
+			Piece &piece = pieces[offset+p];
+			piece.imageName.swap(other.pieces[p].imageName);
+			piece.center = other.pieces[p].center;
+			for (int k = 0; k < 4; k++) {
+				Edge &edge = edges[4*(offset+p)+k], &source = other.edges[4*p+k];
+				edge.type = source.type;
+				edge.shape.swap(source.shape);
+				edge.color.swap(source.color);
+			}
+		}
+		other.pieces.clear();
+		other.edges.clear();
+	}
+	
+	// returns the references to all pieces in the order of their ids
+	Pieces getPieces() {
+		link();
+		Pieces refs;
+		for (unsigned int p = 0; p < pieces.size(); p++) {
+			refs.push_back(&pieces[p]);
+		}
+		return refs;
+	}
+	
+};
@@ -0,0 +1,273 @@
+/**
+ * Puzzle generator creates the pieces of a synthetic puzzle directly,
+ * without scanning and extracting them, so the solver can be tested
+ * and measured on puzzles of any size.
+ *
+ * Usage:
+ * 1. Initialize the instance with the number of columns and rows of the puzzle
+ *    and the seed, the same seed always gives the same puzzle.
+ * 2. Call generate() to add the pieces into the given PieceStore.
+ * 3. neighbourAccuracy() of the solved layout tells how many neighbours are correct.
+ *
+ * The puzzle is cut along a W x H grid with jittered corners. Every inner border
+ * is a tab made of cubic Bezier curves with random position, width and height,
+ * the outer borders are straight. Both pieces sharing a border get its own copy
+ * with independent noise, each piece is rotated by a random angle and its edges
+ * start at a random corner, and the pieces are stored in a random order.
+ * The colours are sampled from smooth gradients inside the piece (SYNTHETIC_COLORS).
+ *
+ * The solver compares every pair of compatible edges and stores their scores,
+ * so its time and memory grow with the square of the number of pieces.
+ * A few thousand pieces is the practical limit, 10000 pieces need about 16 GB.
+ */
+class PuzzleGenerator {
+
+	int columns, rows;
+	Random random;
+
+	// corners of the grid, (columns+1) x (rows+1)
+	Array2D<RealPoint> corners;
+	// borders from the corner (x,y) to (x+1,y) and from (x,y) to (x,y+1)
+	Array2D<Shape> horizontal, vertical;
+	// for every edge id the id of the edge of the neighbouring piece sharing its border
+	vector<int> mates;
+
+	// point of the cubic Bezier curve
+	static RealPoint bezier(const RealPoint *p, double t) {
+		double s = 1-t;
+		return p[0]*(s*s*s) + p[1]*(3*s*s*t) + p[2]*(3*s*t*t) + p[3]*(t*t*t);
+	}
+
+	// resamples the curve to the points in the distance of one pixel along it
+	static Shape resampleCurve(const Shape &curve) {
+		Shape result(1,curve[0]);
+		double position = 0.0, next = 1.0;
+		for (unsigned int i = 1; i < curve.size(); i++) {
+			const RealVector segment = curve[i]-curve[i-1];
+			double length = segment.length();
+			while (next <= position+length) {
+				result.push_back(curve[i-1] + segment * ((next-position)/length));
+				next += 1.0;
+			}
+			position += length;
+		}
+		if ((result.back()-curve.back()).length() > 0.5)
+			result.push_back(curve.back());
+		else
+			result.back() = curve.back();
+		return result;
+	}
+
+	// the border between two corners, a tab pointing to the given side
+	// (+1 left of the direction from -> to, -1 right of it) or straight for 0
+	Shape border(RealPoint from, RealPoint to, int tab) {
+		const RealVector direction = to-from;
+		const RealVector normal(-direction.y,direction.x);
+
+		// the tab in the coordinates along the border and perpendicular to it,
+		// the side has length 1
+		double center = 0.5 + 0.1 * (random.uniform()-0.5);
+		double width = 0.9 + 0.2 * random.uniform();
+		double height = tab * (0.9 + 0.2 * random.uniform());
+		const double TAB[13][2] = {
+			{0.00,0.00}, {0.25,0.00}, {0.42,0.02}, {0.40,0.10},
+			{0.36,0.22}, {0.38,0.30}, {0.50,0.30},
+			{0.62,0.30}, {0.64,0.22}, {0.60,0.10},
+			{0.58,0.02}, {0.75,0.00}, {1.00,0.00}
+		};
+		RealPoint control[13];
+		for (int i = 0; i < 13; i++) {
+			double u = TAB[i][0], v = TAB[i][1];
+			if (i > 0 && i < 12)
+				u = center + (u-0.5) * width;
+			control[i] = from + direction*u + normal*(v*height);
+		}
+
+		Shape curve;
+		const int SAMPLES = 64;
+		for (int k = 0; k < 4; k++) {
+			for (int i = (k == 0 ? 0 : 1); i <= SAMPLES; i++) {
+				curve.push_back(bezier(control+3*k,double(i)/SAMPLES));
+			}
+		}
+		return resampleCurve(curve);
+	}
+
+	// jitters the corners, the corners on the outer border move only along it
+	void createCorners() {
+		corners.resize(columns+1,rows+1);
+		for (int y = 0; y <= rows; y++) {
+			for (int x = 0; x <= columns; x++) {
+				const RealPoint grid(x,y);
+				RealPoint p = grid * SYNTHETIC_PIECE_SIZE;
+				if (x > 0 && x < columns) p.x += random.normal(SYNTHETIC_JITTER);
+				if (y > 0 && y < rows) p.y += random.normal(SYNTHETIC_JITTER);
+				corners.at(x,y) = p;
+			}
+		}
+	}
+
+	void createBorders() {
+		horizontal.resize(columns,rows+1);
+		for (int y = 0; y <= rows; y++) {
+			for (int x = 0; x < columns; x++) {
+				int tab = (y == 0 || y == rows) ? 0 : 2*random.integer(2)-1;
+				horizontal.at(x,y) = border(corners.at(x,y),corners.at(x+1,y),tab);
+			}
+		}
+		vertical.resize(columns+1,rows);
+		for (int y = 0; y < rows; y++) {
+			for (int x = 0; x <= columns; x++) {
+				int tab = (x == 0 || x == columns) ? 0 : 2*random.integer(2)-1;
+				vertical.at(x,y) = border(corners.at(x,y),corners.at(x,y+1),tab);
+			}
+		}
+	}
+
+	// colour of the puzzle in the given point
+	FixedHSL colorAt(RealPoint p) {
+		FixedHSL color;
+		color.h = color.s = 0;
+		color.l = FixedHSL::SCALE / 2;
+		if (!SYNTHETIC_COLORS) return color;
+
+		double width = columns * SYNTHETIC_PIECE_SIZE, height = rows * SYNTHETIC_PIECE_SIZE;
+		double hue = 0.6 * p.x / width + 0.1 * sin(6 * M_PI * p.y / height) + random.normal(0.01);
+		double saturation = 0.3 + 0.5 * p.y / height + random.normal(0.01);
+		double luminosity = 0.5 + 0.2 * sin(p.x / 37.0) * cos(p.y / 53.0) + random.normal(0.01);
+		hue -= floor(hue);
+		color.h = hue * FixedHSL::SCALE;
+		color.s = max(0.0,min(1.0,saturation)) * FixedHSL::SCALE;
+		color.l = max(0.0,min(1.0,luminosity)) * FixedHSL::SCALE;
+		return color;
+	}
+
+	// copy of the border with the noise and the colours sampled inside the piece,
+	// the frame edges are given by the position of the piece in the grid
+	void createEdge(const Shape &shape, RealPoint center, bool frame, Edge &edge) {
+		ColorSignature colors;
+		edge.shape = shape;
+		for (unsigned int i = 0; i < shape.size(); i++) {
+			const RealVector inside = center-shape[i];
+			double distance = inside.length();
+			colors.push_back(colorAt(shape[i] + inside * (min(EDGE_TO_COLOR_DISTANCE,distance)/distance)));
+			edge.shape[i] += RealPoint(random.normal(SYNTHETIC_NOISE),random.normal(SYNTHETIC_NOISE));
+		}
+		edge.color.assign(colors);
+
+		// the tab pointing into the piece is an outdent as classified
+		// by ShapeAnalysis::shapeScore(), the deviation is the largest distance
+		// of the border without the noise from its chord, positive on the side
+		// of the center
+		const RealVector chord = shape.back()-shape.front();
+		const RealVector c = center-shape.front();
+		double towards = chord.x*c.y - chord.y*c.x > 0 ? 1.0 : -1.0;
+		double deviation = 0.0;
+		for (unsigned int i = 0; i < shape.size(); i++) {
+			const RealVector d = shape[i]-shape.front();
+			double side = towards * (chord.x*d.y - chord.y*d.x) / chord.length();
+			if (abs(side) > abs(deviation)) deviation = side;
+		}
+		// the outer borders are straight and the tabs are at least 0.27 of the side high
+		assert(frame == (abs(deviation) < 0.1 * SYNTHETIC_PIECE_SIZE));
+		if (frame)
+			edge.type = FRAME;
+		else
+			edge.type = deviation > 0 ? OUTDENT : INDENT;
+	}
+
+	public:
+
+	PuzzleGenerator(int columns, int rows, unsigned long long seed)
+		: columns(columns), rows(rows), random(seed) {
+	}
+
+	// adds all pieces of the puzzle into the store
+	void generate(PieceStore &store) {
+		if (columns < 2 || rows < 2)
+			throw "synthetic puzzle has to have at least 2 columns and 2 rows";
+		if (SYNTHETIC_JITTER > 0.1 * SYNTHETIC_PIECE_SIZE || SYNTHETIC_NOISE > 0.02 * SYNTHETIC_PIECE_SIZE)
+			throw "jitter or noise of synthetic puzzle too large for the piece size";
+		createCorners();
+		createBorders();
+
+		int numPieces = columns*rows;
+		int first = store.size();
+		// the piece in the cell c gets the id first+order[c] and its edges start
+		// at the side start[c] of the cell
+		Permutation order = random.permutation(numPieces);
+		vector<int> start(numPieces);
+		for (int c = 0; c < numPieces; c++) {
+			start[c] = random.integer(4);
+		}
+		vector<int> cells(numPieces);
+		for (int c = 0; c < numPieces; c++) {
+			cells[order[c]] = c;
+		}
+
+		mates.assign(4*(first+numPieces),-1);
+		for (int p = 0; p < numPieces; p++) {
+			int c = cells[p], x = c % columns, y = c / columns;
+			int id = store.addPiece();
+			Piece &piece = store.piece(id);
+
+			// clockwise borders from the top left corner as the extracted shapes
+			// flipped to the front side: top, right, bottom and left side
+			Shape sides[4] = {
+				horizontal.at(x,y), vertical.at(x+1,y), horizontal.at(x,y+1), vertical.at(x,y)
+			};
+			reverse(sides[2].begin(),sides[2].end());
+			reverse(sides[3].begin(),sides[3].end());
+			RealPoint center = (corners.at(x,y)+corners.at(x+1,y)+corners.at(x+1,y+1)+corners.at(x,y+1)) / 4;
+
+			piece.center = Utils::convert(center);
+			RigidTransformation rotation(2 * M_PI * random.uniform());
+			for (int k = 0; k < 4; k++) {
+				int side = (start[c]+k) % 4;
+				// the opposite side of the neighbouring cell shares the border,
+				// the sides without a neighbour are on the outer border
+				IntegerPoint neighbour = IntegerPoint(x,y) + Utils::Direction[(side+3)%4];
+				bool frame = neighbour.x < 0 || neighbour.x >= columns || neighbour.y < 0 || neighbour.y >= rows;
+				Edge &edge = store.edge(id,k);
+				createEdge(sides[side],center,frame,edge);
+				Geometry2D::translateInPlace(edge.shape,-center);
+				Geometry2D::transformInPlace(edge.shape,rotation);
+
+				if (frame) continue;
+				int n = neighbour.y*columns + neighbour.x;
+				mates[id*4+k] = 4*(first+order[n]) + ((side+2)%4 - start[n] + 4) % 4;
+			}
+		}
+	}
+
+	// id of the edge sharing the border with the given edge in the generated puzzle
+	// or -1 for the FRAME edges
+	int mate(EdgeRef edge) const {
+		return mates[edge->id];
+	}
+
+	// fraction of the pairs of neighbouring positions of the layout occupied
+	// by the pieces touching by the same border in the generated puzzle
+	double neighbourAccuracy(const PuzzleLayout &layout) const {
+		int pairs = 0, correct = 0;
+		for (int y = 0; y < layout.rows(); y++) {
+			for (int x = 0; x < layout.columns(); x++) {
+				EdgeRef up = layout.at(x,y);
+				if (x+1 < layout.columns()) {
+					EdgeRef right = layout.at(x+1,y);
+					pairs++;
+					if (up != NULL && right != NULL && mate(up->following(1)) == right->following(3)->id)
+						correct++;
+				}
+				if (y+1 < layout.rows()) {
+					EdgeRef down = layout.at(x,y+1);
+					pairs++;
+					if (up != NULL && down != NULL && mate(up->following(2)) == down->id)
+						correct++;
+				}
+			}
+		}
+		return pairs > 0 ? double(correct) / pairs : 0.0;
+	}
+
+};
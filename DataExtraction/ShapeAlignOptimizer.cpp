@@ -2,140 +2,332 @@
  * PatternAlignOptimizer finds the RigidTransformation for the known shape of the piece
  * to exactly match this piece on the image.
  * 
- * First initialize an instance with the image of pieces scanned from the front side.
+ * First initialize an instance with the image of pieces scanned from the front side
+ * together with the expected positions of the pieces.
  *
  * Later call of optimizeAlign() with known shape of the piece together with its expected position
  * will find the best transformation of this shape to match the piece on the image.
  * 
  * Use ObjectDetector, to find the expected positions of pieces, .
+ *
+ * The edges are detected only in the regions around the expected positions.
+ * The starting transformations are first scored on a subsampled shape and only
+ * the most promising ones are refined in the full resolution. When the silhouette
+ * of the piece is known, only the poses estimated by SilhouetteMatcher are tried
+ * instead of all rotations.
  */
+// prefix sums of the edge intensity over one rectangular region of the image
+// - the region covers the neighbourhood of one expected piece position
+// - the sums use the coordinates relative to the origin of the region and are
+// kept modulo 2^32, the box sums are still exact while they fit into 32 bits
+struct EdgeTile {
+	// position of the region in the image
+	IntegerPoint origin;
+	// size of the tables, one more than the size of the region
+	int columns, rows;
+	// sums of weights w, moments w*x and w*y
+	vector<unsigned int> weight, momentX, momentY;
+	
+	inline int index(int x, int y) const {
+		return y*columns + x;
+	}
+};
+
 class PatternAlignOptimizer {
 	
-	// table of prefix sums
-	Array2D<WeightedPoint> table;
+	// the maximal radius of the square area used in AverageEdgePoint
+	static const int MAX_EDGE_RADIUS = 15;
+	// distance the shape can move from its expected position during the search
+	static const int SEARCH_MARGIN = 32;
+	
+	// tables of prefix sums, one for each expected position
+	vector<EdgeTile> tiles;
+	RealPoints tileCenters;
 	
 	// Computes the average edge position and its intensity
 	// in a square area of the image defined by the central point and a given radius.
 	// The average edge position is defined as a center of mass of this area
 	// when each pixel has the weight equal to its value defined by an edge detection.
-	WeightedPoint AverageEdgePoint(RealPoint p, int radius) const {
-		IntegerPoint g = Utils::convert(p);
+	WeightedPoint AverageEdgePoint(const EdgeTile &tile, RealPoint p, int radius) const {
+		assert(radius <= MAX_EDGE_RADIUS);
+		IntegerPoint g = Utils::convert(p) - tile.origin;
 		
 		g.x = max(g.x,radius);
 		g.y = max(g.y,radius);
-		g.x = min(g.x,table.columns()-radius-2);
-		g.y = min(g.y,table.rows()-radius-2);
+		g.x = min(g.x,tile.columns-radius-2);
+		g.y = min(g.y,tile.rows-radius-2);
+		
+		int aa = tile.index(g.x+radius+1,g.y+radius+1);
+		int ab = tile.index(g.x-radius-0,g.y+radius+1);
+		int ba = tile.index(g.x+radius+1,g.y-radius-0);
+		int bb = tile.index(g.x-radius-0,g.y-radius-0);
 		
-		WeightedPoint aa = table.at(g.x+radius+1,g.y+radius+1);
-		WeightedPoint ab = table.at(g.x-radius-0,g.y+radius+1);
-		WeightedPoint ba = table.at(g.x+radius+1,g.y-radius-0);
-		WeightedPoint bb = table.at(g.x-radius-0,g.y-radius-0);
+		unsigned int weight  = tile.weight[aa]  - tile.weight[ab]  - tile.weight[ba]  + tile.weight[bb];
+		unsigned int momentX = tile.momentX[aa] - tile.momentX[ab] - tile.momentX[ba] + tile.momentX[bb];
+		unsigned int momentY = tile.momentY[aa] - tile.momentY[ab] - tile.momentY[ba] + tile.momentY[bb];
 		
-		double sum = aa.first - ab.first - ba.first + bb.first;
-		RealPoint point = aa.second - ab.second - ba.second + bb.second;
+		double sum = weight / 255.0;
+		RealPoint point;
 		// no edge in the neighbourhood case
-		if (Utils::doubleEqual(sum,0.0))
+		if (weight == 0)
 			point = p;
 		else
-			point /= sum;
+			point = RealPoint(double(momentX)/weight,double(momentY)/weight) + Utils::convert(tile.origin);
 		
 		return make_pair( sum, point );
 	}
 	
-	// performs an edge detection on the given image assigning each pixel
-	// its edge intensity.
-	Image EdgeImage(Image image) {
-		image.reduceNoise();
-		image.reduceNoise();
-		image.edge();
-		return BinaryObjectExtractor::ImageValue(image);
-	}
-	
-	// precomputes the table of prefix sums to allow running of the AverageEdgePoint in O(1)
-	void PrecomputeLookupTable(const Image &image) {
-		int rows = image.rows();
-		int columns = image.columns();
+	// precomputes the tables of prefix sums over the given region of the edge image
+	// to allow running of the AverageEdgePoint in O(1)
+	static EdgeTile PrecomputeLookupTable(const PlanarImage::Plane &image, int imageColumns, Geometry region) {
+		int columns = region.width();
+		int rows = region.height();
+		EdgeTile tile;
+		tile.origin = IntegerPoint(region.xOff(),region.yOff());
+		tile.columns = columns+1;
+		tile.rows = rows+1;
+		assert(double(2*MAX_EDGE_RADIUS+1)*(2*MAX_EDGE_RADIUS+1)*255*max(columns,rows) < 4294967296.0);
 		
-		table.resize(columns+1,rows+1);
+		// weights of the region
+		PlanarImage::Plane weights(columns*rows);
+		for (int y = 0; y < rows; y++) {
+			const unsigned char* row = &image[(tile.origin.y+y)*imageColumns + tile.origin.x];
+			copy(row,row+columns,weights.begin()+y*columns);
+		}
+		PlanarImage::integral(weights,columns,rows,tile.weight);
 		
-		const PixelPacket *pixel = image.getConstPixels(0,0,columns,rows);
+		// moments, the unsigned arithmetic wraps around
+		tile.momentX.assign(tile.columns*tile.rows,0);
+		tile.momentY.assign(tile.columns*tile.rows,0);
 		for (int y = 0; y < rows; y++) {
+			unsigned int sumX = 0, sumY = 0;
 			for (int x = 0; x < columns; x++) {
-				double weight = ColorGray(*pixel++).shade();
-				WeightedPoint ba = table.at(x,y+1), ab = table.at(x+1,y), bb = table.at(x,y);
-				table.at(x+1,y+1) = make_pair(
-					weight                       + ab.first  + ba.first  - bb.first,
-					RealPoint(weight*x,weight*y) + ab.second + ba.second - bb.second
-				);
+				unsigned int w = weights[y*columns+x];
+				sumX += w*x;
+				sumY += w*y;
+				int i = tile.index(x+1,y+1), above = tile.index(x+1,y);
+				tile.momentX[i] = sumX + tile.momentX[above];
+				tile.momentY[i] = sumY + tile.momentY[above];
 			}
 		}
+		return tile;
 	}
 	
-	// Finds the average edge position in the neighbourhood of each point of the given shape.
-	pair<Shape,Weight> EdgePoints(const Shape &shape, int radius = 10) const {
-		Shape edge;
-		Weight weight;
+	// computes the tile of one region of the image, the regions are independent
+	// and processed in parallel
+	class TileBuilder {
+		// samples around the region needed by the filters, two medians and the edge detection
+		static const int FILTER_BORDER = 3;
+		
+		const PlanarImage *image;
+		Geometry region;
+		EdgeTile tile;
+		
+		// performs an edge detection on the given part of the image assigning each pixel
+		// its edge intensity, the maximum over the colour channels
+		PlanarImage::Plane EdgeImage(int x, int y, int columns, int rows) const {
+			PlanarImage::Plane edges;
+			for (int k = 0; k < 3; k++) {
+				PlanarImage::Channel channel = PlanarImage::Channel(k);
+				PlanarImage::Plane plane = PlanarImage::crop(image->plane(channel),image->columns(),x,y,columns,rows);
+				plane = PlanarImage::median(plane,columns,rows);
+				plane = PlanarImage::median(plane,columns,rows);
+				plane = PlanarImage::edge(plane,columns,rows);
+				edges = k == 0 ? plane : PlanarImage::maximum(edges,plane);
+			}
+			return edges;
+		}
+		
+		public:
+		
+		TileBuilder(const PlanarImage *image, Geometry region)
+			: image(image), region(region) {
+		}
+		
+		// filters the region together with its border and precomputes its tile
+		void build() {
+			int minX = max(0,int(region.xOff())-FILTER_BORDER);
+			int minY = max(0,int(region.yOff())-FILTER_BORDER);
+			int maxX = min(image->columns(),int(region.xOff()+region.width())+FILTER_BORDER);
+			int maxY = min(image->rows(),int(region.yOff()+region.height())+FILTER_BORDER);
+			int columns = maxX-minX, rows = maxY-minY;
+			PlanarImage::Plane edges = EdgeImage(minX,minY,columns,rows);
+			Geometry inner(region.width(),region.height(),region.xOff()-minX,region.yOff()-minY);
+			tile = PrecomputeLookupTable(edges,columns,inner);
+			tile.origin = IntegerPoint(region.xOff(),region.yOff());
+		}
+		
+		const EdgeTile& getTile() const {
+			return tile;
+		}
+	};
+	
+	// region of the image around the expected position, which can be reached
+	// by a shape of given radius during the search
+	static Geometry searchRegion(RealPoint position, double radius, int columns, int rows) {
+		int reach = int(radius) + SEARCH_MARGIN;
+		IntegerPoint p = Utils::convert(position);
+		int minX = max(0,p.x-reach), maxX = min(columns-1,p.x+reach);
+		int minY = max(0,p.y-reach), maxY = min(rows-1,p.y+reach);
+		return Geometry(maxX-minX+1,maxY-minY+1,minX,minY);
+	}
+	
+	// tile precomputed for the expected position closest to the given one
+	const EdgeTile& closestTile(RealPoint position) const {
+		return tiles[ Geometry2D::closestPoint(position,tileCenters) ];
+	}
+	
+	// Finds the average edge position in the neighbourhood of each point of the given shape
+	// and the best matching of the shape to these edge points in one pass.
+	// Returns the sum of the edge intensities.
+	double EdgeAlign(const EdgeTile &tile, const Shape &shape, int radius, RigidTransformation &t) const {
+		Geometry2D::AlignAccumulator accumulator;
+		double score = 0.0;
 		for (int i = 0; i < int(shape.size()); i++) {
-			WeightedPoint wp = AverageEdgePoint(shape[i],radius);
-			weight.push_back(wp.first);
-			edge.push_back(wp.second);
+			WeightedPoint wp = AverageEdgePoint(tile,shape[i],radius);
+			score += wp.first;
+			accumulator.add(wp.second,shape[i]);
 		}
-		return make_pair(edge,weight);
+		t = accumulator.optimalAlign();
+		return score;
+	}
+	
+	// radius of the area searched for the edges in the given iteration
+	static int iterationRadius(int iteration) {
+		return max(MAX_EDGE_RADIUS-iteration,1);
 	}
 	
 	// Iteratively reoptimalizes the rigid transformation of the shape until it
 	// finds a local optimum when the shape matches with edges on the image.
-	ScoredAlign optimizeAlign(Shape pattern) const {
+	ScoredAlign optimizeAlign(const EdgeTile &tile, Shape pattern) const {
 		double score = 0.0;
-		for (int i = 0; i < 10; i++) {
+		for (int i = 0; i < ALIGN_ITERATIONS; i++) {
 			// in each iteration search in smaller area
-			pair<Shape,Weight> edge = EdgePoints(pattern,15-i);
 			// find the best matching of the shape to the edges in its neighbourhood
-			RigidTransformation t = Geometry2D::optimalAlign(edge.first,pattern);
-			pattern = Geometry2D::transform(pattern,t);
-			score = SignalProcessor<double>::sum(edge.second);
+			RigidTransformation t;
+			score = EdgeAlign(tile,pattern,iterationRadius(i),t);
+			Geometry2D::transformInPlace(pattern,t);
 		}
 		return ScoredAlign(score,pattern);
 	}
 	
+	// candidate transformation of the shape together with its score
+	typedef pair<double,RigidTransformation> ScoredTransformation;
+	
+	static bool higherScore(const ScoredTransformation &a, const ScoredTransformation &b) {
+		return a.first > b.first;
+	}
+	
+	// takes every ALIGN_COARSE_STEP-th point of the shape
+	static Shape coarseShape(const Shape &shape) {
+		Shape coarse;
+		for (unsigned int i = 0; i < shape.size(); i += ALIGN_COARSE_STEP) {
+			coarse.push_back(shape[i]);
+		}
+		return coarse;
+	}
+	
+	// cheaply reoptimalizes the given starting transformation of the subsampled shape
+	// in a few iterations, the search is abandoned after the first iteration
+	// if the score is below the given bound
+	ScoredTransformation coarseAlign(const EdgeTile &tile, const Shape &coarse, RigidTransformation t, double abandonBelow) const {
+		Shape pattern = Geometry2D::transform(coarse,t);
+		double score = 0.0;
+		for (int i = 0; i < ALIGN_COARSE_ITERATIONS; i++) {
+			RigidTransformation r;
+			score = EdgeAlign(tile,pattern,iterationRadius(i),r);
+			if (i == 0 && score < abandonBelow)
+				break;
+			Geometry2D::transformInPlace(pattern,r);
+			t = Geometry2D::compositeTransformation(t,r);
+		}
+		return ScoredTransformation(score,t);
+	}
+	
+	// scores all starting transformations of the subsampled shape and returns
+	// the best ALIGN_NUM_REFINED of them
+	vector<ScoredTransformation> coarseSearch(const EdgeTile &tile, const Shape &shape, const vector<RigidTransformation> &starts) const {
+		Shape coarse = coarseShape(shape);
+		vector<ScoredTransformation> best;
+		for (unsigned int i = 0; i < starts.size(); i++) {
+			// hypotheses much worse than the ones already kept are not worth finishing
+			double bound = -Utils::DOUBLE_INF;
+			if (int(best.size()) == ALIGN_NUM_REFINED)
+				bound = ALIGN_ABANDON_RATIO * best.back().first;
+			best.push_back(coarseAlign(tile,coarse,starts[i],bound));
+			sort(best.begin(),best.end(),higherScore);
+			if (int(best.size()) > ALIGN_NUM_REFINED)
+				best.pop_back();
+		}
+		return best;
+	}
+	
+	// refines the hypotheses in the full resolution and updates the best align
+	void refine(const EdgeTile &tile, const Shape &shape, const vector<ScoredTransformation> &hypotheses, ScoredAlign &bestAlign) const {
+		for (unsigned int i = 0; i < hypotheses.size(); i++) {
+			ScoredAlign align = optimizeAlign(tile,Geometry2D::transform(shape,hypotheses[i].second));
+			if (align.first > bestAlign.first)
+				bestAlign = align;
+		}
+	}
+	
 	public:
 	
-	// initialize with the image of the front sides of pieces
-	PatternAlignOptimizer(const Image &image) {
-		Image edges = EdgeImage(image);
-		PrecomputeLookupTable(edges);
+	// initialize with the image of the front sides of pieces and the expected
+	// positions of pieces having at most given radius, the edges are
+	// detected only in the neighbourhood of these positions
+	PatternAlignOptimizer(const Image &image, const RealPoints &positions, double radius) {
+		PlanarImage planar(image);
+		vector<TileBuilder> builders;
+		for (unsigned int i = 0; i < positions.size(); i++) {
+			Geometry region = searchRegion(positions[i],radius,planar.columns(),planar.rows());
+			builders.push_back(TileBuilder(&planar,region));
+			tileCenters.push_back(positions[i]);
+		}
+		Parallel::ForEach(builders,&TileBuilder::build);
+		for (unsigned int i = 0; i < builders.size(); i++) {
+			tiles.push_back(builders[i].getTile());
+		}
 	}
 	
 	// Find the best transformation of the shape to match the
 	// piece having its expected center on the given position
-	Shape optimizeAlign(Shape pattern, RealPoint position) const {
-		pattern = Geometry2D::translate(pattern,-Geometry2D::centerOfPolygon(pattern));
+	// - all starting transformations are scored on the subsampled shape first
+	// and only the best few are refined in the full resolution
+	// - the silhouette of the piece, if not empty, is used to estimate the pose
+	Shape optimizeAlign(Shape pattern, RealPoint position, const Shape &silhouette = Shape()) const {
+		Geometry2D::translateInPlace(pattern,-Geometry2D::centerOfPolygon(pattern));
+		const EdgeTile &tile = closestTile(position);
 		
 		ScoredAlign bestAlign;
 		bestAlign.first = -Utils::DOUBLE_INF;
 		
-		// try 72 starting transformations
-		for (int angle = 0; angle < 360; angle += 5) {
-			Shape baseAlign = Geometry2D::transform(
-				pattern,RigidTransformation(Utils::DegreesToRadians(angle),position)
-			);
-			// find the best matching
-			ScoredAlign align = optimizeAlign(baseAlign);
-			if (align.first > bestAlign.first)
-				bestAlign = align;
+		// poses matching the silhouette are precise enough to be refined directly
+		if (SilhouetteMatcher::matchingSilhouette(pattern,silhouette)) {
+			vector<RigidTransformation> poses = SilhouetteMatcher::estimatePoses(pattern,silhouette,NUM_SILHOUETTE_POSES);
+			refine(tile,pattern,coarseSearch(tile,pattern,poses),bestAlign);
+			if (!poses.empty())
+				return optimizeAlign(tile,bestAlign.second).second;
+		}
+		
+		// otherwise try all rotations, 72 of them by default
+		vector<RigidTransformation> rotations;
+		for (int angle = 0; angle < 360; angle += ALIGN_ROTATION_STEP) {
+			rotations.push_back(RigidTransformation(Utils::DegreesToRadians(angle),position));
 		}
+		refine(tile,pattern,coarseSearch(tile,pattern,rotations),bestAlign);
 		
 		// try to further optimize the best transformation by moving it a few pixels
 		Shape shape = bestAlign.second;
-		for (int x = -6; x <= +6; x += 3) {
-			for (int y = -6; y <= +6; y+= 3) {
-				Shape s = Geometry2D::translate(shape,RealPoint(x,y));
-				ScoredAlign align = optimizeAlign(s);
-				if (align.first > bestAlign.first)
-					bestAlign = align;
+		vector<RigidTransformation> translations;
+		const int range = ALIGN_TRANSLATION_RANGE, step = ALIGN_TRANSLATION_STEP;
+		for (int x = -range; x <= +range; x += step) {
+			for (int y = -range; y <= +range; y += step) {
+				translations.push_back(RigidTransformation(0.0,x,y));
 			}
 		}
+		refine(tile,shape,coarseSearch(tile,shape,translations),bestAlign);
 		
-		return optimizeAlign(bestAlign.second).second;
+		return optimizeAlign(tile,bestAlign.second).second;
 	}
 };
@@ -27,12 +27,12 @@ class ShapeAligner {
 			j = min(j,length2-1);
 			int a = j-1, b = j+1;
 			double dist = (shape1[i]-shape2[j]).squareLength();
-			while (a >= 0 && a > j-5) {
+			while (a >= 0 && a > j-PAIR_SEARCH_WINDOW) {
 				double d = (shape1[i]-shape2[a]).squareLength();
 				if (d < dist) dist = d, j = a;
 				a--;
 			}
-			while (b < length2 && b < j+5) {
+			while (b < length2 && b < j+PAIR_SEARCH_WINDOW) {
 				double d = (shape1[i]-shape2[b]).squareLength();
 				if (d < dist) dist = d, j = b;
 				b++;
@@ -43,11 +43,11 @@ class ShapeAligner {
 	
 	// finds the optimal rigid transformation to place the edge along the x-axis
 	RigidTransformation optimizeLineAlign(const Shape &shape) {
-		Shape line;
+		Geometry2D::AlignAccumulator accumulator;
 		for (unsigned int i = 0; i < shape.size(); i++) {
-			line.push_back(RealPoint(shape[i].x,0));
+			accumulator.add(RealPoint(shape[i].x,0),shape[i]);
 		}
-		return Geometry2D::optimalAlign(line,shape);
+		return accumulator.optimalAlign();
 	}
 	
 	public:
@@ -56,27 +56,32 @@ class ShapeAligner {
 	// layou for this two edges in a lower resolution (runs faster ).
 	ShapeAlign shapeAlign(const Shape &shape1, const Shape &shape2, ShapeAlign align) {
 		RigidTransformation t;
+		// the transformed second shape, the buffer is reused in all iterations
+		Shape shapeT;
+		int iterations = 0;
 		// reoprimize the transformation until the layout is not changing
 		do {
-			Shape shapeT = Geometry2D::transform(shape2,align.t);
+			Geometry2D::transform(shape2,align.t,shapeT);
 			// find the matching points on the curves
 			findPairs(shape1,shapeT,align.pairs12);
 			findPairs(shapeT,shape1,align.pairs21);
 			
-			Shape s1, s2;
+			// find the optimal transformation under the given matching points
+			Geometry2D::AlignAccumulator accumulator;
 			for (unsigned int i = 0; i < align.pairs12.size(); i++) {
-				s1.push_back(shape1[i]);
-				s2.push_back(shapeT[ align.pairs12[i] ]);
+				accumulator.add(shape1[i],shapeT[ align.pairs12[i] ]);
 			}
 			for (unsigned int i = 0; i < align.pairs21.size(); i++) {
-				s2.push_back(shapeT[i]);
-				s1.push_back(shape1[ align.pairs21[i] ]);
+				accumulator.add(shape1[ align.pairs21[i] ],shapeT[i]);
 			}
-			// find the optimal transformation under the given matching points
-			t = Geometry2D::optimalAlign(s1,s2);
+			t = accumulator.optimalAlign();
 			align.t = Geometry2D::compositeTransformation(align.t,t);
+			iterations++;
 		} while (!Utils::identity(t));
 		
+		Metrics::count(Metrics::SHAPE_ALIGN_CALLS);
+		Metrics::count(Metrics::ICP_ITERATIONS,iterations);
+		Metrics::record(Metrics::ICP_ITERATIONS_PER_ALIGN,iterations);
 		return align;
 	}
 	
@@ -104,9 +109,10 @@ class ShapeAligner {
 	// with defined angle to the x-axis
 	RigidTransformation lineAlign(const Shape &shape, double angle = 0.0) {
 		RigidTransformation t, transform(Geometry2D::angle(shape.back()-shape[0]));
+		Shape s;
 		// reoptimize the transformation until the layout is not changing
 		do {
-			Shape s = Geometry2D::transform(shape,transform);
+			Geometry2D::transform(shape,transform,s);
 			t = optimizeLineAlign(s);
 			transform = Geometry2D::compositeTransformation(transform,t);
 		} while (!Utils::identity(t));
@@ -4,19 +4,6 @@
  */
 namespace ShapeAnalysis {
 	
-	// generates all possible combination of choosing four
-	// points from N
-	vector<Quadruplet> quadruplets(int n) {
-		vector<Quadruplet> result;
-		Quadruplet q;
-		for (q[0] = 0; q[0] < n; q[0]++)
-			for (q[1] = q[0]+1; q[1] < n; q[1]++)
-				for (q[2] = q[1]+1; q[2] < n; q[2]++)
-					for (q[3] = q[2]+1; q[3] < n; q[3]++)
-						result.push_back(q);
-		return result;
-	}
-	
 	// computes the first derivation of the curve
 	vector<double> relativeAngles(Shape shape) {
 		int length = shape.size();
@@ -37,32 +24,17 @@ namespace ShapeAnalysis {
 		return angles;
 	}
 	
-	// computes the smooth second derivation of the given curve.
-	// to smooth the curve is used gaussuan blur with defined sigma = blurRadius
-	vector<double> shapeSignature(const Shape &shape, double blurRadius = 10.0) {
-		vector<double> angles = relativeAngles(shape);
-		vector<double> diff = SignalProcessor<double>::difference(angles);
-		vector<double> filtered = SignalProcessor<double>::gaussianBlur(diff,blurRadius);
-		return filtered;
-	}
-	
-	// computes the second derivative for closed curves
-	vector<double> circularShapeSignature(const Shape &shape) {
+	// computes the smooth second derivation of the given closed curve,
+	// the turning angle in each point blurred by the gaussian with sigma = blurRadius
+	vector<double> circularShapeSignature(const Shape &shape, double blurRadius = 10.0) {
 		int length = shape.size();
-		
-		Shape extendedShape = shape;
-		for (int i = 0; i < length; i++) {
-			extendedShape.push_back(shape[i]);
-		}
+		vector<double> turning(length);
 		for (int i = 0; i < length; i++) {
-			extendedShape.push_back(shape[i]);
+			RealVector in  = shape[i] - shape[(i+length-1)%length];
+			RealVector out = shape[(i+1)%length] - shape[i];
+			turning[i] = Utils::angleDiff(atan2(-in.y,in.x),atan2(-out.y,out.x));
 		}
-		vector<double> signature = shapeSignature(extendedShape);
-		
-		rotate(signature.begin(),signature.begin()+length,signature.end());
-		signature.resize(length);
-		
-		return signature;
+		return SignalProcessor<double>::circularGaussianBlur(turning,blurRadius);
 	}
 	
 	// checks if the point is a local minimum in the neighbourhood of radius pixels.
@@ -169,17 +141,6 @@ namespace ShapeAnalysis {
 		return IndentScore(shape);
 	}
 	
-	// returns the overall score of the given combination of the points defining
-	// four subcurves
-	double combinationScore(Quadruplet c, const Array2D<double> &scoreTable) {
-		double worstScore = 0;
-		double sumScore = 0;
-		for (int i = 0; i < 4; i++) {
-			sumScore += scoreTable.at(c[i],c[successor(i,4)]);
-			worstScore = max(worstScore,scoreTable.at(c[i],c[successor(i,4)]));
-		}
-		return worstScore+sumScore;
-	}
 	
 	template<class T>
 	vector<T> filterSmallElements(vector< pair<T,double> > objects, double ratio = 0.5) {
@@ -246,36 +207,154 @@ namespace ShapeAnalysis {
 		return make_pair(score,type);
 	}
 	
-	// returns four corner of given shape of a piece
-	Quadruplet IdentifyCorners(const Shape &shape) {
-		// find all candidates for corner points
-		vector<int> candidates = getPossibleCorners(shape);
-		int numCandidates = candidates.size();
-		// precompute the score for each possible subcurve defined by points
-		Array2D<double> scoreTable(numCandidates,numCandidates);
-		for (int i = 0; i < numCandidates; i++) {
-			for (int j = 0; j < numCandidates; j++) {
-				if (i != j) {
-					Shape segment = subSegment(shape,candidates[i],candidates[j]);
-					scoreTable.at(i,j) = shapeScore(segment).first;
+	// scores of the subcurves between the candidate corners
+	// computed only when they are needed for the first time
+	class SegmentScores {
+		const Shape &shape;
+		const vector<int> &candidates;
+		Array2D<double> table;
+		
+		public:
+		
+		SegmentScores(const Shape &shape, const vector<int> &candidates)
+			: shape(shape), candidates(candidates) {
+			int length = candidates.size();
+			table.resize(length,length);
+			for (int i = 0; i < length; i++) {
+				for (int j = 0; j < length; j++) {
+					table.at(i,j) = -1.0;
 				}
 			}
 		}
-		// generate all possible combinations of four points
-		vector<Quadruplet> combinations = quadruplets(numCandidates);
 		
-		typedef pair<double,Quadruplet> WeightedQuadruplet;
-		// judge each combination and select the best one
-		WeightedQuadruplet best(Utils::DOUBLE_INF,Quadruplet());
-		for (unsigned int i = 0; i < combinations.size(); i++) {
-			array<RealPoint,4> cornerPoints;
-			for (int j = 0; j < 4; j++) {
-				cornerPoints[j] = shape[ candidates[ combinations[i][j] ] ];
+		double at(int i, int j) {
+			double &score = table.at(i,j);
+			if (score < 0)
+				score = shapeScore(subSegment(shape,candidates[i],candidates[j])).first;
+			return score;
+		}
+	};
+	
+	// overall score of the combination of the points defining four subcurves,
+	// the worst subcurve score plus the sum of the scores
+	// - the partial score of the first k subcurves is never higher than the overall one
+	struct CombinationScore {
+		double worst, sum;
+		
+		CombinationScore() : worst(0.0), sum(0.0) {
+		}
+		
+		CombinationScore add(double score) const {
+			CombinationScore result = *this;
+			result.worst = max(worst,score);
+			result.sum += score;
+			return result;
+		}
+		
+		double value() const {
+			return worst + sum;
+		}
+	};
+	
+	// checks if the angle of the quadrilateral in the corner b is close to the right angle
+	bool plausibleAngle(RealPoint a, RealPoint b, RealPoint c) {
+		double angle = abs(Utils::angleDiff(Geometry2D::angle(a-b),Geometry2D::angle(c-b)));
+		return abs(angle-M_PI/2) <= Utils::DegreesToRadians(MAX_CORNER_ANGLE_DEVIATION);
+	}
+	
+	// checks if the sides of the quadrilateral do not differ too much in length
+	bool plausibleSides(const array<RealPoint,4> &corners) {
+		double shortest = Utils::DOUBLE_INF, longest = 0.0;
+		for (int i = 0; i < 4; i++) {
+			double side = (corners[successor(i,4)]-corners[i]).length();
+			shortest = min(shortest,side);
+			longest = max(longest,side);
+		}
+		return longest <= MAX_CORNER_SIDE_RATIO * shortest;
+	}
+	
+	// branch and bound search for the best combination of four candidate corners
+	class CornerSearch {
+		const Shape &shape;
+		const vector<int> &candidates;
+		SegmentScores scores;
+		// accept only combinations forming a plausible quadrilateral
+		bool geometric;
+		
+		Quadruplet current;
+		Quadruplet best;
+		double bestScore;
+		
+		RealPoint corner(int k) const {
+			return shape[ candidates[ current[k] ] ];
+		}
+		
+		// checks the corners already chosen up to the given depth
+		bool plausible(int depth) const {
+			if (!geometric || depth < 2) return true;
+			if (depth == 2)
+				return plausibleAngle(corner(0),corner(1),corner(2));
+			array<RealPoint,4> corners;
+			for (int k = 0; k < 4; k++) {
+				corners[k] = corner(k);
+			}
+			return plausibleAngle(corners[1],corners[2],corners[3])
+				&& plausibleAngle(corners[2],corners[3],corners[0])
+				&& plausibleAngle(corners[3],corners[0],corners[1])
+				&& plausibleSides(corners);
+		}
+		
+		// chooses the corner on given depth, the combinations are visited in the
+		// lexicographic order, so the first one of the equally scored is kept
+		void search(int depth, CombinationScore partial) {
+			int numCandidates = candidates.size();
+			for (int i = depth == 0 ? 0 : current[depth-1]+1; i < numCandidates-(3-depth); i++) {
+				current[depth] = i;
+				if (!plausible(depth))
+					continue;
+				CombinationScore score = partial;
+				if (depth > 0)
+					score = score.add(scores.at(current[depth-1],i));
+				if (depth == 3)
+					score = score.add(scores.at(i,current[0]));
+				if (score.value() >= bestScore)
+					continue;
+				if (depth == 3)
+					bestScore = score.value(), best = current;
+				else
+					search(depth+1,score);
 			}
-			double score = combinationScore(combinations[i],scoreTable);
-			best = min(best,WeightedQuadruplet(score,combinations[i]));
 		}
 		
+		public:
+		
+		CornerSearch(const Shape &shape, const vector<int> &candidates)
+			: shape(shape), candidates(candidates), scores(shape,candidates) {
+		}
+		
+		// returns the indices of candidates of the best combination,
+		// the score is infinite if there is no acceptable combination
+		pair<double,Quadruplet> findBest(bool geometric) {
+			this->geometric = geometric;
+			bestScore = Utils::DOUBLE_INF;
+			best = Quadruplet();
+			search(0,CombinationScore());
+			return make_pair(bestScore,best);
+		}
+	};
+	
+	// returns four corner of given shape of a piece
+	Quadruplet IdentifyCorners(const Shape &shape) {
+		// find all candidates for corner points
+		vector<int> candidates = getPossibleCorners(shape);
+		// judge the combinations and select the best one, the scores of the subcurves
+		// are shared by both searches
+		CornerSearch search(shape,candidates);
+		pair<double,Quadruplet> best = search.findBest(true);
+		// no combination forms a plausible quadrilateral
+		if (best.first == Utils::DOUBLE_INF)
+			best = search.findBest(false);
+		
 		Quadruplet corners;
 		for (int i = 0; i < 4; i++) {
 			corners[i] = candidates[ best.second[i] ];
@@ -284,3 +363,24 @@ namespace ShapeAnalysis {
 	}
 	
 };
+
+// identifies the corners of one shape, the shapes are independent
+// and processed in parallel
+class CornerIdentifier {
+	Shape shape;
+	Quadruplet corners;
+	
+	public:
+	
+	CornerIdentifier(const Shape &shape)
+		: shape(shape) {
+	}
+	
+	void identify() {
+		corners = ShapeAnalysis::IdentifyCorners(shape);
+	}
+	
+	Quadruplet getCorners() const {
+		return corners;
+	}
+};
@@ -0,0 +1,80 @@
+/**
+ * Silhouette matcher estimates the pose of the known shape of a piece
+ * from the rough silhouette of the same piece found on the front scan.
+ *
+ * Both curves are described by the distance of their points from the center
+ * sampled uniformly along the curve. Rotating the piece shifts this signature
+ * cyclically, so the best shifts are found as the maximas of the circular
+ * cross-correlation of both signatures and converted to rigid transformations.
+ */
+namespace SilhouetteMatcher {
+
+	// samples the closed curve in given number of points uniformly distributed along it
+	Shape resampleClosedCurve(const Shape &shape, int length) {
+		int n = shape.size();
+		vector<double> position(n+1);
+		for (int i = 0; i < n; i++) {
+			position[i+1] = position[i] + (shape[(i+1)%n]-shape[i]).length();
+		}
+		Shape curve;
+		double step = position[n] / length;
+		int j = 0;
+		for (int i = 0; i < length; i++) {
+			double p = i*step;
+			while (j+1 < n && position[j+1] <= p) j++;
+			double segment = position[j+1]-position[j];
+			double ratio = segment > 0 ? (p-position[j]) / segment : 0.0;
+			const RealPoint direction = shape[(j+1)%n]-shape[j];
+			curve.push_back(shape[j] + direction * ratio);
+		}
+		return curve;
+	}
+
+	// distance of each point of the curve from its mean, without the mean distance
+	vector<double> centroidSignature(const Shape &curve) {
+		RealPoint center = SignalProcessor<RealPoint>::mean(curve);
+		vector<double> signature;
+		for (unsigned int i = 0; i < curve.size(); i++) {
+			signature.push_back((curve[i]-center).length());
+		}
+		double mean = SignalProcessor<double>::mean(signature);
+		for (unsigned int i = 0; i < signature.size(); i++) {
+			signature[i] -= mean;
+		}
+		return signature;
+	}
+
+	// determines if the silhouette can be used to estimate the pose of the shape
+	bool matchingSilhouette(const Shape &shape, const Shape &silhouette) {
+		if (silhouette.size() < 3) return false;
+		double area = Geometry2D::areaOfPolygon(shape);
+		return abs(Geometry2D::areaOfPolygon(silhouette)-area) <= MAX_SILHOUETTE_AREA_DIFFERENCE * area;
+	}
+
+	// returns at most given number of the most probable rigid transformations
+	// of the shape to match the silhouette, the best one first
+	vector<RigidTransformation> estimatePoses(const Shape &shape, const Shape &silhouette, int count) {
+		const int length = SILHOUETTE_SIGNATURE_LENGTH;
+		Shape pattern = resampleClosedCurve(shape,length);
+		Shape target = resampleClosedCurve(silhouette,length);
+		// traverse both curves in the same direction
+		if (Geometry2D::signedAreaOfPolygon(pattern) * Geometry2D::signedAreaOfPolygon(target) < 0)
+			reverse(pattern.begin(),pattern.end());
+
+		vector<double> correlation = FourierTransform::circularCorrelation(
+			centroidSignature(pattern),centroidSignature(target)
+		);
+		vector<int> shifts = SignalProcessor<double>::findLocalMaximas(correlation,length/32);
+
+		vector<RigidTransformation> poses;
+		for (int k = 0; k < count && k < int(shifts.size()); k++) {
+			Shape shifted(length);
+			for (int i = 0; i < length; i++) {
+				shifted[i] = target[(i+shifts[k])%length];
+			}
+			poses.push_back(Geometry2D::optimalAlign(shifted,pattern));
+		}
+		return poses;
+	}
+
+};
@@ -16,7 +16,9 @@
 
 #include <complex>
 #include <iostream>
+#include <fstream>
 #include <sstream>
+#include <iomanip>
 #include <complex>
 #include <string>
 #include <vector>
@@ -36,6 +38,9 @@
 #include <tr1/array>
 #include <boost/thread.hpp>
 #include <boost/bind.hpp>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 using namespace std;
 using namespace tr1;
@@ -46,32 +51,43 @@ using namespace Magick;
 
 #include "Utils/Vector2D.cpp"
 #include "Utils/Array2D.cpp"
+#include "Utils/Bitmap.cpp"
 
 #include "Constants.cpp"
+#include "Configuration.cpp"
 #include "Settings.cpp"
 #include "Types.cpp"
 
 #include "Utils/Utility.cpp"
+#include "Utils/Random.cpp"
+#include "Utils/Trace.cpp"
+#include "Utils/Metrics.cpp"
 #include "Utils/Parallel.cpp"
+#include "Utils/FourierTransform.cpp"
 #include "Utils/SignalProcessor.cpp"
 #include "Utils/Geometry2D.cpp"
 #include "Utils/ShapeUtils.cpp"
 #include "Utils/MorphologicProcessor.cpp"
+#include "Utils/PlanarImage.cpp"
 #include "PuzzleSolving/MinCostMatching.cpp"
 #include "PuzzleSolving/SuccessiveMinCostMatching.cpp"
 
+#include "DataExtraction/PieceStore.cpp"
 #include "DataExtraction/ComponentExtractor.cpp"
 #include "DataExtraction/BinaryObjectExtractor.cpp"
 #include "DataExtraction/ObjectDetector.cpp"
+#include "DataExtraction/SilhouetteMatcher.cpp"
 #include "DataExtraction/ShapeAlignOptimizer.cpp"
 #include "DataExtraction/ShapeClassificator.cpp"
 #include "DataExtraction/PieceExtractor.cpp"
 #include "DataExtraction/ExtractionPipeline.cpp"
+#include "DataExtraction/PuzzleGenerator.cpp"
 #include "DataExtraction/ShapeAligner.cpp"
 
 #include "PuzzleSolving/CompatibilityClassificator.cpp"
 #include "PuzzleSolving/EdgeScores.cpp"
 #include "PuzzleSolving/CompatibilityTable.cpp"
+#include "PuzzleSolving/CascadeTuner.cpp"
 
 #include "Visualization/LinearSystemSolver.cpp"
 #include "Visualization/GeometricLayoutComputer.cpp"
@@ -81,8 +97,8 @@ using namespace Magick;
 #include "PuzzleSolving/InteriorSolver.cpp"
 #include "PuzzleSolving/Solver.cpp"
 
-// loads all the pieces from given images of front and backs sides of the pieces
-Pieces loadPieces(vector<string> frontImages, vector<string> backImages) {
+// loads all the pieces from given images of front and backs sides of the pieces into the store
+void loadPieces(vector<string> frontImages, vector<string> backImages, PieceStore &store) {
 	int numImages = frontImages.size();
 	if (numImages != int(backImages.size()))
 		throw "bad number of input files";
@@ -92,26 +108,60 @@ Pieces loadPieces(vector<string> frontImages, vector<string> backImages) {
 		pipelines.push_back(ExtractionPipeline(frontImages[i],backImages[i]));
 	}
 	cout << "data extraction" << endl;
+	Trace::Span span("loadPieces");
 	// run parallel extraction
 	Parallel::ForEach(pipelines,&ExtractionPipeline::extractPieces);
-	vector<Pieces> pieces;
-	// gather results
+	// gather results, the pieces are renumbered densely
 	for (unsigned int i = 0; i < pipelines.size(); i++) {
-		pieces.push_back(pipelines[i].getPieces());
+		store.append(pipelines[i].getStore());
 	}
-	return Utils::Join(pieces);
 }
 
+#ifndef PUZZLE_NO_MAIN
 int main(int argc, char** argv) {
 	Settings settings(argc,argv);
-	Pieces pieces = loadPieces(settings.getFrontFileNames(),settings.getBackFileNames());
+	if (!settings.getTraceFileName().empty())
+		Trace::enable();
+	if (!settings.getMetricsFileName().empty())
+		Metrics::enable();
+	PieceStore store;
+	pair<int,int> size = settings.getSyntheticSize();
+	PuzzleGenerator generator(size.first,size.second,SYNTHETIC_SEED);
+	if (settings.isSynthetic())
+		generator.generate(store);
+	else
+		loadPieces(settings.getFrontFileNames(),settings.getBackFileNames(),store);
+	Pieces pieces = store.getPieces();
+	
+	// choose the parameters of the cascade for the size of the puzzle
+	if (settings.isTuning()) {
+		CascadeTuner tuner(pieces);
+		tuner.tune();
+		tuner.save(settings.getTuningFileName());
+	} else if (!settings.getTuningFileName().empty()) {
+		CascadeTuner::load(settings.getTuningFileName(),pieces.size());
+	}
 	
 	Solver solver;
 	PuzzleLayout layout = solver.assemblePuzzle(pieces);
 	
-	Visualizer visualizer;
-	Image result = visualizer.visualize(layout);
-	result.write(settings.getOutputFileName());
+	// synthetic pieces have no images to visualize
+	if (settings.isSynthetic()) {
+		GeometricLayoutComputer computer;
+		computer.computeLayout(layout);
+		printf("neighbour accuracy: %.4f\n",generator.neighbourAccuracy(layout));
+	} else {
+		Visualizer visualizer;
+		Image result = visualizer.visualize(layout);
+		// record the parameters the result was computed with
+		result.comment(Configuration::describe());
+		result.write(settings.getOutputFileName());
+	}
 	
+	if (Trace::enabled)
+		Trace::write(settings.getTraceFileName());
+	if (Metrics::enabled)
+		Metrics::write(settings.getMetricsFileName());
 	return 0;
 }
+#endif
@@ -0,0 +1,239 @@
+/**
+ * Cascade tuner chooses RESOLUTION_DEPTH and BASE_SIZE of the multi-resolution
+ * cascade computing the rows of the compatibility table.
+ *
+ * A sample of rows is computed by the cascade for every candidate configuration
+ * and compared with the reference computed in the full resolution for all edges.
+ * The fastest configuration reaching TUNING_TARGET_RECALL of the TUNING_TOP_K
+ * best edges of the reference is chosen. The results are stored in the tuning file,
+ * one line per size class of the puzzle, so later runs of similar size reuse them.
+ *
+ * Usage:
+ * 1. initialize the instance with the pieces of the puzzle
+ * 2. call tune() to measure the candidates and apply the chosen one
+ * 3. call save() to store the result, load() applies the stored result
+ */
+class CascadeTuner {
+	
+	public:
+	
+	// speed and quality of one configuration of the cascade
+	struct Measurement {
+		int depth, baseSize;
+		// sampled rows computed per second
+		double rowsPerSecond;
+		// fraction of the rows with the same best edge as the reference
+		double top1Recall;
+		// fraction of the best TUNING_TOP_K edges of the reference found
+		// among the best TUNING_TOP_K edges
+		double topKRecall;
+	};
+	
+	private:
+	
+	int numPieces;
+	// all edges indexed by their id
+	Edges edges;
+	// edges of the sampled rows
+	Edges sample;
+	int components;
+	EdgeScores::Kernel kernel;
+	// ranking of the edges in each sampled row computed in the full resolution
+	vector<Edges> reference;
+	Measurement chosen;
+	
+	// the smallest number of pieces of a puzzle in the size class is a power of two
+	static int sizeClass(int numPieces) {
+		int size = 0;
+		while ((1 << size) < numPieces) size++;
+		return size;
+	}
+	
+	// takes evenly spaced non-frame edges as the rows to compute
+	void sampleRows() {
+		Edges candidates;
+		for (unsigned int i = 0; i < edges.size(); i++) {
+			if (edges[i]->type != FRAME)
+				candidates.push_back(edges[i]);
+		}
+		int size = min(int(candidates.size()),TUNING_SAMPLE_SIZE);
+		for (int i = 0; i < size; i++) {
+			sample.push_back(candidates[ i * candidates.size() / size ]);
+		}
+	}
+	
+	// the compatible edges ordered from the best score in the row
+	Edges ranking(const EdgeScores &row, const ScaledEdges &scaledEdges) const {
+		vector<ScoredEdge> scored;
+		const Edges &bucket = scaledEdges.buckets[CompatibilityClassificator::complementaryKey(row.edge)];
+		for (unsigned int i = 0; i < bucket.size(); i++) {
+			if (CompatibilityClassificator::compatibleTypes(row.edge,bucket[i]))
+				scored.push_back(ScoredEdge((row.*kernel.getScore)(bucket[i]),bucket[i]));
+		}
+		sort(scored.begin(),scored.end());
+		Edges result;
+		for (unsigned int i = 0; i < scored.size(); i++) {
+			result.push_back(scored[i].second);
+		}
+		return result;
+	}
+	
+	// computes the sampled rows by the cascade of given configuration,
+	// returns the rankings of the rows and the time spent in seconds
+	vector<Edges> rankRows(int depth, int baseSize, double &seconds) {
+		using namespace boost::posix_time;
+		int oldDepth = RESOLUTION_DEPTH, oldBaseSize = BASE_SIZE;
+		RESOLUTION_DEPTH = depth;
+		BASE_SIZE = baseSize;
+		
+		ScaledEdges scaledEdges = CompatibilityTable::scaleEdges(edges,components);
+		vector<EdgeScores> rows;
+		for (unsigned int i = 0; i < sample.size(); i++) {
+			rows.push_back(EdgeScores(sample[i]));
+		}
+		ptime start = microsec_clock::universal_time();
+		Parallel::ForEach(rows,kernel.init,scaledEdges);
+		seconds = (microsec_clock::universal_time() - start).total_microseconds() / 1e6;
+		
+		vector<Edges> rankings;
+		for (unsigned int i = 0; i < rows.size(); i++) {
+			rankings.push_back(ranking(rows[i],scaledEdges));
+		}
+		CompatibilityTable::deleteScaledEdges(scaledEdges);
+		
+		RESOLUTION_DEPTH = oldDepth;
+		BASE_SIZE = oldBaseSize;
+		return rankings;
+	}
+	
+	// compares the rankings with the reference
+	Measurement measure(int depth, int baseSize, const vector<Edges> &rankings, double seconds) const {
+		Measurement m = { depth, baseSize, sample.size() / max(seconds,1e-6), 0.0, 0.0 };
+		int numRows = 0;
+		for (unsigned int i = 0; i < rankings.size(); i++) {
+			const Edges &expected = reference[i];
+			if (expected.empty()) continue;
+			numRows++;
+			m.top1Recall += rankings[i][0] == expected[0];
+			int k = min(int(expected.size()),TUNING_TOP_K);
+			int found = 0;
+			for (int j = 0; j < k; j++) {
+				found += find(rankings[i].begin(),rankings[i].begin()+k,expected[j]) != rankings[i].begin()+k;
+			}
+			m.topKRecall += double(found) / k;
+		}
+		if (numRows > 0) {
+			m.top1Recall /= numRows;
+			m.topKRecall /= numRows;
+		} else {
+			m.top1Recall = m.topKRecall = 1.0;
+		}
+		return m;
+	}
+	
+	static void print(const Measurement &m) {
+		cout << "depth " << m.depth << ", base size " << m.baseSize << ": "
+		     << m.rowsPerSecond << " rows/s, top-1 recall " << m.top1Recall
+		     << ", top-" << TUNING_TOP_K << " recall " << m.topKRecall << endl;
+	}
+	
+	// sets the parameters of the cascade
+	static void apply(int depth, int baseSize) {
+		ostringstream d, b;
+		d << depth;
+		b << baseSize;
+		Configuration::set("RESOLUTION_DEPTH",d.str());
+		Configuration::set("BASE_SIZE",b.str());
+	}
+	
+	public:
+	
+	// initialize with all pieces of the puzzle
+	CascadeTuner(const Pieces &pieces) : numPieces(pieces.size()), edges(4*pieces.size()) {
+		for (unsigned int i = 0; i < pieces.size(); i++) {
+			for (int k = 0; k < 4; k++) {
+				edges[pieces[i]->edges[k]->id] = pieces[i]->edges[k];
+			}
+		}
+		components = EdgeScores::activeComponents();
+		kernel = EdgeScores::kernel(components);
+		sampleRows();
+	}
+	
+	// measures all candidate configurations, applies the fastest one
+	// reaching the target recall and returns it
+	Measurement tune() {
+		const int depths[] = { 2, 3, 4, 5 };
+		const int baseSizes[] = { 10, 25, 50, 100, 200 };
+		
+		cout << "Tuning the cascade on " << sample.size() << " rows" << endl;
+		// in one level all edges are scored in the full resolution
+		double seconds;
+		reference = rankRows(1,BASE_SIZE,seconds);
+		chosen = measure(1,BASE_SIZE,reference,seconds);
+		print(chosen);
+		
+		for (int i = 0; i < 4; i++) {
+			for (int j = 0; j < 5; j++) {
+				vector<Edges> rankings = rankRows(depths[i],baseSizes[j],seconds);
+				Measurement m = measure(depths[i],baseSizes[j],rankings,seconds);
+				print(m);
+				if (m.topKRecall >= TUNING_TARGET_RECALL && m.rowsPerSecond > chosen.rowsPerSecond)
+					chosen = m;
+			}
+		}
+		cout << "chosen ";
+		print(chosen);
+		apply(chosen.depth,chosen.baseSize);
+		return chosen;
+	}
+	
+	// stores the chosen configuration for the size class of the puzzle,
+	// the lines of other size classes are kept
+	void save(const string &fileName) const {
+		map<int,string> lines;
+		ifstream in(fileName.c_str());
+		string line;
+		while (getline(in,line)) {
+			int size;
+			if (line.empty() || line[0] == '#') continue;
+			if (istringstream(line) >> size)
+				lines[size] = line;
+		}
+		in.close();
+		
+		ostringstream out;
+		out << sizeClass(numPieces) << ' ' << chosen.depth << ' ' << chosen.baseSize << ' '
+		    << chosen.rowsPerSecond << ' ' << chosen.top1Recall << ' ' << chosen.topKRecall;
+		lines[sizeClass(numPieces)] = out.str();
+		
+		ofstream file(fileName.c_str());
+		if (!file)
+			throw "cannot write tuning file";
+		file << "# size class (log2 of pieces), RESOLUTION_DEPTH, BASE_SIZE,"
+		     << " rows per second, top-1 recall, top-k recall" << endl;
+		FOREACH(it,lines) {
+			file << it->second << endl;
+		}
+	}
+	
+	// applies the configuration stored for the size class of the puzzle with
+	// given number of pieces, returns false if there is none
+	static bool load(const string &fileName, int numPieces) {
+		ifstream file(fileName.c_str());
+		if (!file)
+			throw "cannot open tuning file";
+		string line;
+		while (getline(file,line)) {
+			int size, depth, baseSize;
+			if (line.empty() || line[0] == '#') continue;
+			istringstream in(line);
+			if (in >> size >> depth >> baseSize && size == sizeClass(numPieces)) {
+				apply(depth,baseSize);
+				return true;
+			}
+		}
+		return false;
+	}
+	
+};
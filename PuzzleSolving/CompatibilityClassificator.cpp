@@ -2,7 +2,7 @@
  * Computes the basic compatibility scores for shape and colour,
  * optimized for using with scaled edges
  * Usage:
- * 1. create scaled versions of two edges (edge + several edges in a lower resolution)
+ * 1. create scaled versions of two edges (several edges in a lower resolution + edge)
  * 2. initialize the instance with this scaled edges
  * 3. each call of recomputeScore returns score of edges computed
  *    using higher resolution than previous call
@@ -21,33 +21,77 @@ class CompatibilityClassificator {
 	} ColorScore;
 	
 	// distance of points on circle
-	inline double circleDist(double a, double b) {
+	static inline double circleDist(double a, double b) {
 		if (a > b) swap(a,b);
 		return min(b-a,1.0-b+a);
 	}
 	
-	inline double squareDist(double x) {
+	static inline double squareDist(double x) {
 		return x * x;
 	}
 	
-	// computes baseic shape score
-	double shapeScore(const Shape &shape1, const Shape &shape2, const Permutation &pairs) {
+#ifdef __SSE2__
+	static inline double horizontalSum(__m128 v) {
+		float sum[4];
+		_mm_storeu_ps(sum,v);
+		return double(sum[0]) + sum[1] + sum[2] + sum[3];
+	}
+#endif
+	
+	// computes baseic shape score, the second shape is transformed on the fly
+	double shapeScore(const Shape &shape1, const Shape &shape2, const Geometry2D::Transformer &transform2) {
 		double sum = 0.0;
-		for (unsigned int i = 0; i < pairs.size(); i++) {
-			sum += (shape1[i]-shape2[pairs[i]]).squareLength();
+		for (unsigned int i = 0; i < align.pairs12.size(); i++) {
+			sum += (shape1[i]-transform2(shape2[ align.pairs12[i] ])).squareLength();
+		}
+		for (unsigned int i = 0; i < align.pairs21.size(); i++) {
+			sum += (transform2(shape2[i])-shape1[ align.pairs21[i] ]).squareLength();
 		}
 		return sum;
 	}
 	
-	// computes basic colour scores
-	ColorScore colorScore(const ColorSignature &color1, const ColorSignature &color2, const Permutation &pairs) {
+	// computes basic colour scores of the given components, four points at once
+	// where SSE2 is available
+	template <int COMPONENTS>
+	static ColorScore colorScore(const ColorPlanes &color1, const ColorPlanes &color2, const Permutation &pairs) {
 		ColorScore score = { 0.0, 0.0, 0.0 };
-		for (unsigned int i = 0; i < pairs.size(); i++) {
-			ColorHSL c1 = color1[i];
-			ColorHSL c2 = color2[pairs[i]];
-			score.H += circleDist(c1.hue(),c2.hue());
-			score.S += squareDist(c1.saturation()-c2.saturation());
-			score.L += squareDist(c1.luminosity()-c2.luminosity());
+		int length = pairs.size();
+		int i = 0;
+#ifdef __SSE2__
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+		__m128 sumH = _mm_setzero_ps(), sumS = _mm_setzero_ps(), sumL = _mm_setzero_ps();
+		for (; i+4 <= length; i += 4) {
+			// the paired points of the second edge are not consecutive
+			const int *p = &pairs[i];
+			if (COMPONENTS & HUE_SCORE) {
+				__m128 h2 = _mm_set_ps(color2.H[p[3]],color2.H[p[2]],color2.H[p[1]],color2.H[p[0]]);
+				__m128 h = _mm_and_ps(_mm_sub_ps(_mm_loadu_ps(&color1.H[i]),h2),absMask);
+				sumH = _mm_add_ps(sumH,_mm_min_ps(h,_mm_sub_ps(one,h)));
+			}
+			if (COMPONENTS & SATURATION_SCORE) {
+				__m128 s2 = _mm_set_ps(color2.S[p[3]],color2.S[p[2]],color2.S[p[1]],color2.S[p[0]]);
+				__m128 s = _mm_sub_ps(_mm_loadu_ps(&color1.S[i]),s2);
+				sumS = _mm_add_ps(sumS,_mm_mul_ps(s,s));
+			}
+			if (COMPONENTS & LUMINOSITY_SCORE) {
+				__m128 l2 = _mm_set_ps(color2.L[p[3]],color2.L[p[2]],color2.L[p[1]],color2.L[p[0]]);
+				__m128 l = _mm_sub_ps(_mm_loadu_ps(&color1.L[i]),l2);
+				sumL = _mm_add_ps(sumL,_mm_mul_ps(l,l));
+			}
+		}
+		score.H = horizontalSum(sumH);
+		score.S = horizontalSum(sumS);
+		score.L = horizontalSum(sumL);
+#endif
+		for (; i < length; i++) {
+			int j = pairs[i];
+			if (COMPONENTS & HUE_SCORE)
+				score.H += circleDist(color1.H[i],color2.H[j]);
+			if (COMPONENTS & SATURATION_SCORE)
+				score.S += squareDist(color1.S[i]-color2.S[j]);
+			if (COMPONENTS & LUMINOSITY_SCORE)
+				score.L += squareDist(color1.L[i]-color2.L[j]);
 		}
 		return score;
 	}
@@ -70,16 +114,20 @@ class CompatibilityClassificator {
 		align.pairs21 = ISP::resample(align.pairs21,len2B);
 	}
 	
-	// create scaled version of the edge
-	static EdgeRef scaleEdge(EdgeRef edge, double scale) {
+	// create scaled version of the edge, only the colour planes of the given
+	// score components are resampled
+	static EdgeRef scaleEdge(EdgeRef edge, double scale, int components) {
 		Edge *e  = new Edge;
 		e->id    = edge->id;
-		e->prev  = edge->prev;
-		e->next  = edge->next;
 		e->piece = edge->piece;
 		e->type  = edge->type;
 		e->shape = SignalProcessor<RealPoint>::resample(edge->shape,scale);
-		e->color = SignalProcessor<Color>::resample(edge->color,scale);
+		if (components & HUE_SCORE)
+			e->color.H = SignalProcessor<float>::resample(edge->color.H,scale);
+		if (components & SATURATION_SCORE)
+			e->color.S = SignalProcessor<float>::resample(edge->color.S,scale);
+		if (components & LUMINOSITY_SCORE)
+			e->color.L = SignalProcessor<float>::resample(edge->color.L,scale);
 		return e;
 	}
 	
@@ -90,12 +138,14 @@ class CompatibilityClassificator {
 		edge1(edge1), edge2(edge2), level(0) {
 	}
 	
-	// recompute the score using higher resolution
+	// recompute the score using higher resolution, the colour scores
+	// are computed only for the given components
+	template <int COMPONENTS>
 	Score recomputeScore() {
 		const Shape &shape1 = edge1[level]->shape;
 		const Shape &shape2 = edge2[level]->shape;
-		const ColorSignature &color1 = edge1[level]->color;
-		const ColorSignature &color2 = edge2[level]->color;
+		const ColorPlanes &color1 = edge1[level]->color;
+		const ColorPlanes &color2 = edge2[level]->color;
 		
 		if (level == 0) {
 			align = aligner.shapeAlign(shape1, shape2);
@@ -105,18 +155,18 @@ class CompatibilityClassificator {
 		}
 		
 		int length = align.pairs12.size() + align.pairs21.size();
-		Shape shapeT = Geometry2D::transform(shape2,align.t);
 		
 		Score score = { 0.0, 0.0, 0.0, 0.0 };
-		score.shape += shapeScore(shape1,shapeT,align.pairs12);
-		score.shape += shapeScore(shapeT,shape1,align.pairs21);
+		score.shape += shapeScore(shape1,shape2,Geometry2D::Transformer(align.t));
 		score.shape /= length;
 		
-		ColorScore c1 = colorScore(color1,color2,align.pairs12);
-		ColorScore c2 = colorScore(color2,color1,align.pairs21);
-		score.H += (c1.H + c2.H) / length;
-		score.S += (c1.S + c2.S) / length;
-		score.L += (c1.L + c2.L) / length;
+		if (COMPONENTS & COLOR_SCORES) {
+			ColorScore c1 = colorScore<COMPONENTS>(color1,color2,align.pairs12);
+			ColorScore c2 = colorScore<COMPONENTS>(color2,color1,align.pairs21);
+			score.H += (c1.H + c2.H) / length;
+			score.S += (c1.S + c2.S) / length;
+			score.L += (c1.L + c2.L) / length;
+		}
 		
 		level++;
 		return score;
@@ -127,25 +177,41 @@ class CompatibilityClassificator {
 		if (edge1->piece == edge2->piece) return false;
 		if (edge1->type == edge2->type) return false;
 		if (edge1->type != -edge2->type) return false;
-		if (bool(edge1->next->type) != bool(edge2->prev->type)) return false;
-		if (bool(edge1->prev->type) != bool(edge2->next->type)) return false;
+		if (bool(edge1->next()->type) != bool(edge2->prev()->type)) return false;
+		if (bool(edge1->prev()->type) != bool(edge2->next()->type)) return false;
 		return true;
 	}
 
-	// create set of scaled edges in lower resolution for the given edge
-	static ScaledEdge createScaledEdge(EdgeRef edge) {
+	// number of distinct values of typeKey()
+	static const int NUM_TYPE_KEYS = 12;
+	
+	// key of the edge determined by its type and the FRAME-ness of its neighbours
+	static int typeKey(EdgeRef edge) {
+		return 4*(edge->type+1) + 2*bool(edge->prev()->type) + bool(edge->next()->type);
+	}
+	
+	// key of the edges which can logically fit the given edge
+	// - compatibleTypes() holds only for edges with this key (or none for FRAME edges)
+	static int complementaryKey(EdgeRef edge) {
+		return 4*(-edge->type+1) + 2*bool(edge->next()->type) + bool(edge->prev()->type);
+	}
+	
+	// create set of scaled edges from the lowest resolution to the full one
+	// for the given edge keeping the colours needed by the given score components,
+	// the given edge itself is the last one
+	static ScaledEdge createScaledEdge(EdgeRef edge, int components) {
 		ScaledEdge scaledEdge;
-		scaledEdge.push_back(edge);
 		for (int i = 1; i < RESOLUTION_DEPTH; i++) {
-			double scale = 1.0 - double(i) / RESOLUTION_DEPTH;
-			scaledEdge.push_back(scaleEdge(edge,scale));
+			double scale = double(i) / RESOLUTION_DEPTH;
+			scaledEdge.push_back(scaleEdge(edge,scale,components));
 		}
+		scaledEdge.push_back(edge);
 		return scaledEdge;
 	}
 	
-	// dispose the set of scaled edges
+	// dispose the set of scaled edges, the edge in the full resolution is kept
 	static void deleteScaledEdge(ScaledEdge &edge) {
-		for (int i = 1; i < RESOLUTION_DEPTH; i++)
+		for (unsigned int i = 0; i+1 < edge.size(); i++)
 			delete edge[i];
 		edge.clear();
 	}
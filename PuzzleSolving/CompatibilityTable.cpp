@@ -4,34 +4,58 @@
 class CompatibilityTable {
 	// rows of the table
 	vector<EdgeScores> scores;
+	// scoring specialised for the score components in use
+	EdgeScores::Kernel kernel;
 	
 	public:
 	// disable the given edge, the edge won't be considered as potentionally best matching edge anymore
 	inline void disableEdge(EdgeRef edge) {
-		Parallel::ForEach(scores,&EdgeScores::disableEdge,edge);
+		Metrics::count(Metrics::DISABLE_EDGE_CALLS);
+		Parallel::ForEach(scores,kernel.disableEdge,edge);
 	}
 	
 	// returns the score for given pair of edges
 	inline double score(EdgeRef edge1, EdgeRef edge2) const {
-		return scores[edge1->id].getScore(edge2) + scores[edge2->id].getScore(edge1);
+		return (scores[edge1->id].*kernel.getScore)(edge2) + (scores[edge2->id].*kernel.getScore)(edge1);
+	}
+	
+	// creates for every edge the versions in lower resolution keeping the colours
+	// of the given score components, the edges are grouped by type
+	// so each row visits only complementary edges
+	static ScaledEdges scaleEdges(const Edges &edges, int components) {
+		ScaledEdges scaledEdges;
+		for (unsigned int i = 0; i < edges.size(); i++) {
+			scaledEdges.edges.push_back(CompatibilityClassificator::createScaledEdge(edges[i],components));
+		}
+		scaledEdges.buckets.resize(CompatibilityClassificator::NUM_TYPE_KEYS);
+		for (unsigned int i = 0; i < edges.size(); i++) {
+			scaledEdges.buckets[CompatibilityClassificator::typeKey(edges[i])].push_back(edges[i]);
+		}
+		return scaledEdges;
+	}
+	
+	// dispose the memory allocated for scaled versions of edges
+	static void deleteScaledEdges(ScaledEdges &scaledEdges) {
+		for (unsigned int i = 0; i < scaledEdges.edges.size(); i++) {
+			CompatibilityClassificator::deleteScaledEdge(scaledEdges.edges[i]);
+		}
 	}
 	
 	// Initializes the compatibility table for given set of edges
 	CompatibilityTable(const Edges &edges) {
-		// create for every edge the versions in lower resolution
-		vector<ScaledEdge> scaledEdges = MAP1(
-			ScaledEdge,CompatibilityClassificator::createScaledEdge,edges
-		);
+		Trace::Span span("CompatibilityTable");
+		// choose the scoring for the components with non-zero weight,
+		// colours are not touched at all in a shape-only run
+		int components = EdgeScores::activeComponents();
+		kernel = EdgeScores::kernel(components);
+		ScaledEdges scaledEdges = scaleEdges(edges,components);
 		// create rows of the table
 		for (unsigned int i = 0; i < edges.size(); i++) {
 			scores.push_back(EdgeScores(edges[i]));
 		}
 		// compute the scores in each row of the table
-		Parallel::ForEach(scores,&EdgeScores::init,scaledEdges);
-		// dispose the memory allocated for scaled versions of edges
-		for (unsigned int i = 0; i < scaledEdges.size(); i++) {
-			CompatibilityClassificator::deleteScaledEdge(scaledEdges[i]);
-		}
+		Parallel::ForEach(scores,kernel.init,scaledEdges);
+		deleteScaledEdges(scaledEdges);
 	}
 	
 };
@@ -1,8 +1,20 @@
 /**
  * Representation of one row of the cmpatibility table e.g. scores for 
  * each possible edge to one given edge
+ *
+ * The row is sparse, only the edges compatible with the given edge are stored,
+ * ordered by id, the other edges are disabled. A row holds about a half
+ * of the edges of a puzzle with mostly interior pieces, so the table still
+ * grows with the square of the number of edges.
  */
 
+// scaled versions of all edges together with the edges grouped
+// by CompatibilityClassificator::typeKey()
+struct ScaledEdges {
+	vector<ScaledEdge> edges;
+	vector<Edges> buckets;
+};
+
 class EdgeScores {
 	
 	public:
@@ -18,22 +30,38 @@ class EdgeScores {
 		return s1.score.shape < s2.score.shape;
 	}
 	
+	static bool sortById(const EdgeState &s1, const EdgeState &s2) {
+		return s1.edge->id < s2.edge->id;
+	}
+	
 	EdgeRef edge;
 	Score best;
-	vector<Score> score;	
+	// ids of the stored edges in ascending order and their scores
+	vector<int> candidates;
+	vector<Score> score;
+	
+	// position of the given edge in the row, -1 if it is disabled
+	int position(EdgeRef edge) const {
+		vector<int>::const_iterator it = lower_bound(candidates.begin(),candidates.end(),edge->id);
+		if (it == candidates.end() || *it != edge->id)
+			return -1;
+		return it - candidates.begin();
+	}
 	
 	// get the working versions of edges, this version contains also the optimal layout and matching points
 	// and lives only during a computation of its score
-	vector<EdgeState> getEdgeStates(const vector<ScaledEdge> &edges) {
+	// - only the bucket of complementary edges is visited, the rest of the row stays disabled
+	vector<EdgeState> getEdgeStates(const ScaledEdges &edges) {
 		vector<EdgeState> edgeStates;
-		for (unsigned int i = 0; i < edges.size(); i++) {
-			if (CompatibilityClassificator::compatibleTypes(edge,edges[i][0])) {
+		if (edge->type == FRAME)
+			return edgeStates;
+		const Edges &bucket = edges.buckets[CompatibilityClassificator::complementaryKey(edge)];
+		for (unsigned int i = 0; i < bucket.size(); i++) {
+			if (CompatibilityClassificator::compatibleTypes(edge,bucket[i])) {
 				EdgeState state;
-				state.edge = edges[i][0];
-				state.classificator = new CompatibilityClassificator(edges[edge->id],edges[i]);
+				state.edge = bucket[i];
+				state.classificator = new CompatibilityClassificator(edges.edges[edge->id],edges.edges[bucket[i]->id]);
 				edgeStates.push_back(state);
-			} else {
-				disableEdge(edges[i][0]);
 			}
 		}
 		return edgeStates;
@@ -48,65 +76,130 @@ class EdgeScores {
 	}
 	
 	// finds the best score for each knd of the score
+	template <int COMPONENTS>
 	void recompute() {
 		using Utils::DOUBLE_INF;
 		best = (Score){ DOUBLE_INF, DOUBLE_INF, DOUBLE_INF, DOUBLE_INF };
 		for (unsigned int i = 0; i < score.size(); i++) {
-			best.shape = min(best.shape,score[i].shape);
-			best.H = min(best.H,score[i].H);
-			best.S = min(best.S,score[i].S);
-			best.L = min(best.L,score[i].L);
+			if (COMPONENTS & SHAPE_SCORE)
+				best.shape = min(best.shape,score[i].shape);
+			if (COMPONENTS & HUE_SCORE)
+				best.H = min(best.H,score[i].H);
+			if (COMPONENTS & SATURATION_SCORE)
+				best.S = min(best.S,score[i].S);
+			if (COMPONENTS & LUMINOSITY_SCORE)
+				best.L = min(best.L,score[i].L);
 		}
 	}
 	
 	public:
 	
+	// member functions specialised for one mask of score components
+	struct Kernel {
+		void (EdgeScores::*init)(const ScaledEdges &edges);
+		void (EdgeScores::*disableEdge)(const EdgeRef &edge);
+		double (EdgeScores::*getScore)(EdgeRef edge) const;
+		
+		template <int COMPONENTS>
+		static Kernel create() {
+			Kernel kernel = {
+				&EdgeScores::init<COMPONENTS>,
+				&EdgeScores::disableEdge<COMPONENTS>,
+				&EdgeScores::getScore<COMPONENTS>
+			};
+			return kernel;
+		}
+	};
+	
+	// mask of the score components having non-zero weight
+	static int activeComponents() {
+		return (SHAPE_WEIGHT != 0 ? SHAPE_SCORE : 0)
+		  | (HUE_WEIGHT != 0 ? HUE_SCORE : 0)
+		  | (SATURATION_WEIGHT != 0 ? SATURATION_SCORE : 0)
+		  | (LUMINOSITY_WEIGHT != 0 ? LUMINOSITY_SCORE : 0);
+	}
+	
+	// returns the kernel instantiated for the given mask of score components
+	static Kernel kernel(int components) {
+		static const Kernel kernels[ALL_SCORES+1] = {
+			Kernel::create<0>(),  Kernel::create<1>(),  Kernel::create<2>(),  Kernel::create<3>(),
+			Kernel::create<4>(),  Kernel::create<5>(),  Kernel::create<6>(),  Kernel::create<7>(),
+			Kernel::create<8>(),  Kernel::create<9>(),  Kernel::create<10>(), Kernel::create<11>(),
+			Kernel::create<12>(), Kernel::create<13>(), Kernel::create<14>(), Kernel::create<15>()
+		};
+		return kernels[components & ALL_SCORES];
+	}
+	
 	// initalize the row for given edge
 	EdgeScores(EdgeRef edge) : edge(edge) {
 	}
 	
-	// returns a score for the given edge
+	// returns a score for the given edge, only the given components are combined
+	template <int COMPONENTS>
 	double getScore(EdgeRef edge) const {
-		Score s = score[edge->id];
-		return SHAPE_WEIGHT   * (1 - best.shape / s.shape)
-		  + HUE_WEIGHT        * (1 - best.H / s.H)
-		  + SATURATION_WEIGHT * (1 - best.S / s.S)
-		  + LUMINOSITY_WEIGHT * (1 - best.L / s.L);
+		using Utils::DOUBLE_INF;
+		int i = position(edge);
+		const Score s = i >= 0 ? score[i] : (Score){ DOUBLE_INF, DOUBLE_INF, DOUBLE_INF, DOUBLE_INF };
+		double result = 0.0;
+		if (COMPONENTS & SHAPE_SCORE)
+			result += SHAPE_WEIGHT * (1 - best.shape / s.shape);
+		if (COMPONENTS & HUE_SCORE)
+			result += HUE_WEIGHT * (1 - best.H / s.H);
+		if (COMPONENTS & SATURATION_SCORE)
+			result += SATURATION_WEIGHT * (1 - best.S / s.S);
+		if (COMPONENTS & LUMINOSITY_SCORE)
+			result += LUMINOSITY_WEIGHT * (1 - best.L / s.L);
+		return result;
 	}
 	
 	// computes the scores using the lower resolution versions of each edge
-	void init(const vector<ScaledEdge> &edges) {
-		score.resize(edges.size());
+	template <int COMPONENTS>
+	void init(const ScaledEdges &edges) {
 		vector<EdgeState> edgeStates = getEdgeStates(edges);
 		int numEdges = edgeStates.size();
 		
 		int k = numEdges;
 		// fraction of edges keept in every round
-		const double scale = pow(double(numEdges)/BASE_SIZE,-1.0/RESOLUTION_DEPTH);
+		// - the edge may have no candidates at all in a small puzzle
+		const double scale = pow(double(max(numEdges,1))/BASE_SIZE,-1.0/RESOLUTION_DEPTH);
 		for (int i = 0; i < RESOLUTION_DEPTH; i++) {
+			Trace::Span span("EdgeScores::init level",i);
 			// recompute the score using higher resolution
 			for (int j = 0; j < k; j++) {
 				EdgeState &s = edgeStates[j];
-				s.score = s.classificator->recomputeScore();
+				double start = Metrics::enabled ? Trace::now() : 0.0;
+				s.score = s.classificator->recomputeScore<COMPONENTS>();
+				if (Metrics::enabled)
+					Metrics::record(Metrics::PAIR_SCORING_NS,Utils::Convert(1000*(Trace::now()-start)));
 			}
 			// sort edges by scores
 			sort(edgeStates.begin(),edgeStates.begin()+k,sortByShapeScore);
 			// keep only some fraction to next round
-			k = min(Utils::Convert(k*scale),numEdges);
+			int kept = min(Utils::Convert(k*scale),numEdges);
+			Metrics::countLevel(i,k,k-kept);
+			k = kept;
 		}
 		// fill the comaptibility table
+		sort(edgeStates.begin(),edgeStates.end(),sortById);
+		candidates.resize(numEdges);
+		score.resize(numEdges);
 		for (int i = 0; i < numEdges; i++) {
-			score[ edgeStates[i].edge->id ] = edgeStates[i].score;
+			candidates[i] = edgeStates[i].edge->id;
+			score[i] = edgeStates[i].score;
 		}
 		deleteEdgeStates(edgeStates);
 		
-		recompute();
+		recompute<COMPONENTS>();
 	}
 	// disables one edge, so it won't be considered as the best possibility anymore
+	template <int COMPONENTS>
 	void disableEdge(const EdgeRef &edge) {
-		using Utils::DOUBLE_INF;
-		score[edge->id] = (Score){ DOUBLE_INF, DOUBLE_INF, DOUBLE_INF, DOUBLE_INF };
-		recompute();
+		int i = position(edge);
+		if (i < 0) return;
+		Metrics::count(Metrics::DISABLE_EDGE_ROWS);
+		candidates.erase(candidates.begin()+i);
+		score.erase(score.begin()+i);
+		recompute<COMPONENTS>();
 	}
 
 };
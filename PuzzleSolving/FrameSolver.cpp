@@ -25,9 +25,9 @@ class FrameSolver {
 		for (int i = 0; i < 4; i++) {
 			EdgeRef edge = piece->edges[i];
 			if (edge->type != FRAME) {
-				if (edge->prev->type == FRAME)
+				if (edge->prev()->type == FRAME)
 					res.first = edge;
-				if (edge->next->type == FRAME)
+				if (edge->next()->type == FRAME)
 					res.second = edge;
 			}
 		}
@@ -38,7 +38,7 @@ class FrameSolver {
 	// determines if piece contain two consecutive FRAME edges
 	bool isCornerPiece(PieceRef piece) const {
 		EdgePair edges = matchingEdges(piece);
-		return edges.first->next == edges.second;
+		return edges.first->next() == edges.second;
 	}
 	
 	// returns indices of corner pieces in given sequence of pieces
@@ -94,9 +94,9 @@ class FrameSolver {
 			
 			if (isCornerPiece(piece))
 				dir = (dir+1)%4;
-			layout.at(pos) = matchingEdges(piece).first->prev;
+			layout.at(pos) = matchingEdges(piece).first->prev();
 			for (int j = 0; j < dir; j++) {
-				layout.at(pos) = layout.at(pos)->prev;
+				layout.at(pos) = layout.at(pos)->prev();
 			}
 			pos += Utils::Direction[dir];
 		}
@@ -151,6 +151,8 @@ class FrameSolver {
 		Pieces chain;
 		do {
 			cout << "trying combination number " << ++step << endl;
+			Trace::Span span("FrameSolver iteration",step);
+			Metrics::count(Metrics::FRAME_COMBINATIONS);
 			vector<int> pairs = generator.getNextMatching();
 			printf("%.9lf\n", generator.cost(pairs)); //
 			chain = traceFirstCycle(pairs);
@@ -4,21 +4,106 @@
  * filling is done by placing one piece at a time at some unused position
  */
 class InteriorSolver {
-	// pieces which are not placed already
 	
 	CompatibilityTable *table;
 	PuzzleLayout layout;
+	// pieces which are not placed already
 	Pieces pieces;
 	
+	// allowed edge types for each direction, one bit per EdgeType
+	typedef array<int,4> TypeMask;
+	// canonical edges of not placed pieces grouped by their canonical type pattern
+	typedef map<int,Edges> PieceBuckets;
+	PieceBuckets buckets;
+	
+	static inline int typeBit(EdgeType type) {
+		return 1 << (type+1);
+	}
+	
+	// the edge facing north after rotating the piece by 90 degrees given number of times
+	static EdgeRef rotateEdge(EdgeRef topEdge, int rotation) {
+		return topEdge->following(rotation);
+	}
+	
+	// encodes the types of the edges facing each direction when the given edge faces north,
+	// i-th ternary digit is the type of the edge facing Utils::Direction[i]
+	static int typePattern(EdgeRef topEdge) {
+		int pattern = 0, base = 1;
+		topEdge = topEdge->next();
+		for (int i = 0; i < 4; i++) {
+			pattern += base * (topEdge->type+1);
+			base *= 3;
+			topEdge = topEdge->next();
+		}
+		return pattern;
+	}
+	
+	// returns the edge of the piece giving the smallest type pattern when facing north
+	// - pieces with the same canonical pattern are equal up to the rotation
+	static EdgeRef canonicalEdge(PieceRef piece) {
+		EdgeRef best = piece->edges[0];
+		for (int i = 1; i < 4; i++) {
+			if (typePattern(piece->edges[i]) < typePattern(best))
+				best = piece->edges[i];
+		}
+		return best;
+	}
+	
+	// determines if the piece having given edge facing north has at all
+	// directions an edge type allowed by the mask
+	static bool fitsTypes(EdgeRef topEdge, const TypeMask &mask) {
+		topEdge = topEdge->next();
+		for (int i = 0; i < 4; i++) {
+			if (!(mask[i] & typeBit(topEdge->type)))
+				return false;
+			topEdge = topEdge->next();
+		}
+		return true;
+	}
+	
+	// returns the edge types which can face each direction at the given position
+	// - placed edges have to be complemented, free neighbours need some padding
+	// and the border of the layout needs FRAME edge
+	TypeMask requiredTypes(IntegerPoint position, const PieceEdges &edges) const {
+		TypeMask mask;
+		for (int d = 0; d < 4; d++) {
+			if (edges[d] != NULL)
+				mask[d] = typeBit(EdgeType(-edges[d]->type));
+			else if (layout.valid(position + Utils::Direction[d]))
+				mask[d] = typeBit(INDENT) | typeBit(OUTDENT);
+			else
+				mask[d] = typeBit(FRAME);
+		}
+		return mask;
+	}
+	
+	// groups the pieces by their canonical type pattern
+	void createBuckets() {
+		for (unsigned int i = 0; i < pieces.size(); i++) {
+			EdgeRef edge = canonicalEdge(pieces[i]);
+			buckets[typePattern(edge)].push_back(edge);
+		}
+	}
+	
+	// removes the placed piece from its bucket
+	void removeFromBucket(PieceRef piece) {
+		EdgeRef edge = canonicalEdge(piece);
+		PieceBuckets::iterator bucket = buckets.find(typePattern(edge));
+		Edges &edges = bucket->second;
+		edges.erase(find(edges.begin(),edges.end(),edge));
+		if (edges.empty())
+			buckets.erase(bucket);
+	}
+	
 	// returns the score of coinciding edges for the given possibility
 	double matchingScore(PieceEdges edges, EdgeRef topEdge) {
-		topEdge = topEdge->next;
+		topEdge = topEdge->next();
 		double score = 0;
 		for (int i = 0; i < 4; i++) {
 			if (edges[i] != NULL) {
 				score += table->score(edges[i], topEdge);
 			}
-			topEdge = topEdge->next;
+			topEdge = topEdge->next();
 		}
 		return score;
 	}
@@ -29,10 +114,7 @@ class InteriorSolver {
 		for (int d = 0; d < 4; d++) {
 			IntegerPoint p = position + Utils::Direction[d];
 			if (layout.valid(p) && layout.at(p) != NULL) {
-				edges[d] = layout.at(p)->prev;
-				for (int i = 0; i < d; i++) {
-					edges[d] = edges[d]->next;
-				}
+				edges[d] = layout.at(p)->following(d+3);
 			} else {
 				edges[d] = NULL;
 			}
@@ -76,9 +158,44 @@ class InteriorSolver {
 	}
 	
 	// returns the best possibility of placing some piece at some unused position
+	// considering only the pieces and rotations with the edge types fitting the neighbours
 	PieceLayout getBestChoice() {
 		// get all free spots
 		IntegerPoints positions = getFreePositions();
+		PieceLayout bestLayout;
+		double bestScore = Utils::DOUBLE_INF;
+		for (unsigned int i = 0; i < positions.size(); i++) {
+			PieceEdges edges = placedEdges(positions[i]);
+			TypeMask mask = requiredTypes(positions[i],edges);
+			FOREACH(bucket,buckets) {
+				const Edges &canonical = bucket->second;
+				for (int r = 0; r < 4; r++) {
+					// all pieces in the bucket have the same pattern
+					if (!fitsTypes(rotateEdge(canonical[0],r),mask))
+						continue;
+					for (unsigned int j = 0; j < canonical.size(); j++) {
+						EdgeRef topEdge = rotateEdge(canonical[j],r);
+						double score = matchingScore(edges,topEdge);
+						Metrics::count(Metrics::BEST_CHOICE_CANDIDATES);
+						if (bestScore > score) {
+							bestScore = score;
+							bestLayout.edge = topEdge;
+							bestLayout.position = positions[i];
+						}
+					}
+				}
+			}
+		}
+		// no piece fits, edge types are probably misclassified
+		if (bestScore == Utils::DOUBLE_INF)
+			return getAnyChoice(positions);
+		
+		return bestLayout;
+	}
+	
+	// returns the best possibility of placing some piece at some of given positions
+	// regardless of the edge types
+	PieceLayout getAnyChoice(const IntegerPoints &positions) {
 		PieceLayout bestLayout;
 		double bestScore = Utils::DOUBLE_INF;
 		// backtrack all possibilities and choose the best one
@@ -105,16 +222,17 @@ class InteriorSolver {
 		
 		// delete piece
 		pieces.erase(find(pieces.begin(),pieces.end(),topEdge->piece));
+		removeFromBucket(topEdge->piece);
 
 		// disable the covered edges
 		PieceEdges edges = placedEdges(position);
-		topEdge = topEdge->next;
+		topEdge = topEdge->next();
 		for (int i = 0; i < 4; i++) {
 			if (edges[i] != NULL) {
 				table->disableEdge(edges[i]);
 				table->disableEdge(topEdge);
 			}
-			topEdge = topEdge->next;
+			topEdge = topEdge->next();
 		}
 	}
 	
@@ -122,12 +240,15 @@ class InteriorSolver {
 	
 	// initalize with the layou having empty interior and free pices to place into this interior
 	InteriorSolver(CompatibilityTable *table, const PuzzleLayout &frameLayout, const Pieces &pieces) :
-		table(table), layout(frameLayout), pieces(pieces) { }
+		table(table), layout(frameLayout), pieces(pieces) {
+		createBuckets();
+	}
 	
 	// solves the interior and return the final combinatoric solution
 	PuzzleLayout solve() {
 		// place all pieces one at a time
 		while (!pieces.empty()) {
+			Trace::Span span("InteriorSolver placement",pieces.size());
 			// choose the best possibility
 			PieceLayout choice = getBestChoice();
 			// place the piece at the position
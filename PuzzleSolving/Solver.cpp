@@ -23,11 +23,13 @@ class Solver {
 	}
 	// solve the frame and return the PuzzleLyaout with filled frame positions
 	PuzzleLayout solveFrame(CompatibilityTable *table, const Pieces &frame, const Pieces &interior) {
+		Trace::Span span("FrameSolver");
 		FrameSolver frameSolver(table,frame,interior);
 		return frameSolver.solve();
 	}
 	// fill te interior of the layout with filled frame positions
 	PuzzleLayout solveInterior(CompatibilityTable *table, const PuzzleLayout &frameLayout, const Pieces &interior) {
+		Trace::Span span("InteriorSolver");
 		InteriorSolver interiorSolver(table,frameLayout,interior);
 		return interiorSolver.solve();
 	}
@@ -35,6 +37,7 @@ class Solver {
 	public:
 	// assemble the given pieces and return the combinatoric solution
 	PuzzleLayout assemblePuzzle(const Pieces &pieces) {
+		Trace::Span span("Solver::assemblePuzzle");
 		Edges edges = extractEdges(pieces);
 		
 		cout << "Computing compatibility table" << endl;
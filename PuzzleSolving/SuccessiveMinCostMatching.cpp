@@ -56,6 +56,7 @@ class SuccessiveMinCostMatching {
 	
 	// returns the solution of the restricted problem
 	RestrictedSolution solve(const vector<Pair> &forced, const vector<Pair> &free) {
+		Metrics::count(Metrics::MATCHING_SUBPROBLEMS);
 		
 		MinCostMatching m(size);
 		for (int i = 0; i < size; i++) {
@@ -5,16 +5,38 @@
  * -b list of images of the pieces scanned from the back side in the same order
  *    as corresponding front images
  * -o name of output file
+ * -p preset of the parameters: fast, balanced or exact
+ * -c name of the configuration file
+ * -D NAME=value sets one parameter, overrides the preset, the configuration file
+ *    and the environment variables PUZZLE_NAME
+ * -t name of the tuning file, the cascade is tuned for the size of the puzzle
+ *    and the result is stored in the file
+ * -T name of the tuning file, the cascade parameters stored there for the size
+ *    of the puzzle are used
+ * -r name of the file the trace of the stages is written to in the Chrome trace format
+ * -m name of the file the counters and histograms of the hot paths are written to,
+ *    see Metrics
+ * -g COLUMNSxROWS solves a synthetic puzzle of given size instead of the scans,
+ *    see PuzzleGenerator, the accuracy of the solution is printed
  */
 class Settings {
 	
 	vector<string> frontImages, backImages;
 	string outputFileName;
+	string tuningFileName;
+	string traceFileName;
+	string metricsFileName;
+	bool tuning;
+	pair<int,int> syntheticSize;
 	
 	public:
 	
 	Settings(int argc, char** argv) {
 		outputFileName = "output.jpg";
+		tuning = false;
+		syntheticSize = make_pair(0,0);
+		string preset = "balanced";
+		vector<string> configFiles, definitions;
 		
 		for (int i = 0; i < argc; i++) {
 			string param = argv[i];
@@ -29,6 +51,41 @@ class Settings {
 			if (param == "-o") {
 				outputFileName = argv[++i];
 			}
+			if (param == "-p") {
+				preset = argv[++i];
+			}
+			if (param == "-c") {
+				configFiles.push_back(argv[++i]);
+			}
+			if (param == "-D") {
+				definitions.push_back(argv[++i]);
+			}
+			if (param == "-r") {
+				traceFileName = argv[++i];
+			}
+			if (param == "-m") {
+				metricsFileName = argv[++i];
+			}
+			if (param == "-g") {
+				char separator;
+				istringstream in(argv[++i]);
+				if (!(in >> syntheticSize.first >> separator >> syntheticSize.second) || separator != 'x')
+					throw "bad size of synthetic puzzle";
+			}
+			if (param == "-t" || param == "-T") {
+				tuning = param == "-t";
+				tuningFileName = argv[++i];
+			}
+		}
+		
+		// configure the parameters, the later sources override the earlier ones
+		Configuration::applyPreset(preset);
+		for (unsigned int i = 0; i < configFiles.size(); i++) {
+			Configuration::loadFile(configFiles[i]);
+		}
+		Configuration::loadEnvironment();
+		for (unsigned int i = 0; i < definitions.size(); i++) {
+			Configuration::define(definitions[i]);
 		}
 	}
 	
@@ -44,4 +101,32 @@ class Settings {
 		return outputFileName;
 	}
 	
+	string getTuningFileName() const {
+		return tuningFileName;
+	}
+	
+	// empty if the stages are not traced
+	string getTraceFileName() const {
+		return traceFileName;
+	}
+	
+	// empty if the metrics are not collected
+	string getMetricsFileName() const {
+		return metricsFileName;
+	}
+	
+	// number of columns and rows of the synthetic puzzle, zero if the scans are used
+	pair<int,int> getSyntheticSize() const {
+		return syntheticSize;
+	}
+	
+	bool isSynthetic() const {
+		return syntheticSize.first > 0;
+	}
+	
+	// determines if the cascade is tuned in this run
+	bool isTuning() const {
+		return tuning;
+	}
+	
 };
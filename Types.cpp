@@ -1,6 +1,74 @@
 
 typedef vector<RealPoint> Shape;
-typedef vector<Color> ColorSignature;
+
+// colour in the HSL colour space stored in the fixed point,
+// each component from [0,1] is stored as a multiple of 1/65535
+struct FixedHSL {
+	unsigned short h, s, l;
+	
+	static const double SCALE;
+	
+	double hue() const { return h / SCALE; }
+	double saturation() const { return s / SCALE; }
+	double luminosity() const { return l / SCALE; }
+	
+	// converts the colour with red, green and blue components from [0,1]
+	static FixedHSL fromRGB(double red, double green, double blue) {
+		double maximum = max(red,max(green,blue));
+		double minimum = min(red,min(green,blue));
+		double delta = maximum - minimum;
+		double hue = 0.0, saturation = 0.0, luminosity = (maximum + minimum) / 2;
+		if (delta > 0) {
+			saturation = luminosity < 0.5 ? delta / (maximum + minimum) : delta / (2.0 - maximum - minimum);
+			if (red == maximum)
+				hue = (green - blue) / delta;
+			else if (green == maximum)
+				hue = 2.0 + (blue - red) / delta;
+			else
+				hue = 4.0 + (red - green) / delta;
+			hue /= 6;
+			if (hue < 0) hue += 1.0;
+		}
+		FixedHSL color;
+		color.h = hue * SCALE + 0.5;
+		color.s = saturation * SCALE + 0.5;
+		color.l = luminosity * SCALE + 0.5;
+		return color;
+	}
+};
+
+const double FixedHSL::SCALE = 65535.0;
+
+typedef vector<FixedHSL> ColorSignature;
+
+// colours of a sequence of points stored as separate planes of hue, saturation
+// and luminosity from [0,1], so consecutive points can be compared at once
+struct ColorPlanes {
+	vector<float> H, S, L;
+	
+	int size() const {
+		return H.size();
+	}
+	
+	// replaces the content by the given colours
+	void assign(const ColorSignature &colors) {
+		int length = colors.size();
+		H.resize(length);
+		S.resize(length);
+		L.resize(length);
+		for (int i = 0; i < length; i++) {
+			H[i] = colors[i].hue();
+			S[i] = colors[i].saturation();
+			L[i] = colors[i].luminosity();
+		}
+	}
+	
+	void swap(ColorPlanes &other) {
+		H.swap(other.H);
+		S.swap(other.S);
+		L.swap(other.L);
+	}
+};
 
 typedef vector<Shape> Shapes;
 
@@ -36,7 +104,7 @@ struct Piece {
 	string imageName;
 	// position of the center in the source image
 	IntegerPoint center;
-	// id number of th epiece
+	// id number of the piece, its index in the PieceStore
 	int id;
 	// four edges of the piece
 	PieceEdges edges;
@@ -50,11 +118,8 @@ typedef enum {
 
 // instance of one piece edge
 struct Edge {
-	// unique id of the edge
+	// unique id of the edge, the k-th edge of the piece with id p has id 4*p+k
 	int id;
-	// pointer to the next and previous edge of the same piece
-	// in the clockwise direction
-	EdgeRef prev, next;
 	// pointer to the owning piece
 	PieceRef piece;
 	
@@ -63,7 +128,25 @@ struct Edge {
 	// sequence of points defining the edge
 	Shape shape;
 	// colour extracted for every point in shape
-	ColorSignature color;
+	ColorPlanes color;
+	
+	// position of the edge within its piece in the clockwise direction
+	int side() const {
+		return id % 4;
+	}
+	
+	// edge of the same piece given number of positions further in the clockwise direction
+	EdgeRef following(int offset) const {
+		return piece->edges[(side()+offset)%4];
+	}
+	
+	EdgeRef next() const {
+		return following(1);
+	}
+	
+	EdgeRef prev() const {
+		return following(3);
+	}
 };
 
 typedef tr1::array<int,4> Quadruplet;
@@ -113,6 +196,17 @@ struct Score {
 	float shape, H, S, L;
 };
 
+// bits of the components of the Score, the scoring is specialised
+// for the mask of the components having non-zero weight
+enum ScoreComponent {
+	SHAPE_SCORE = 1,
+	HUE_SCORE = 2,
+	SATURATION_SCORE = 4,
+	LUMINOSITY_SCORE = 8,
+	COLOR_SCORES = HUE_SCORE | SATURATION_SCORE | LUMINOSITY_SCORE,
+	ALL_SCORES = SHAPE_SCORE | COLOR_SCORES
+};
+
 typedef map<PieceRef,double> PieceValues;
 
 struct PieceLayout {
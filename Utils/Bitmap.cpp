@@ -0,0 +1,134 @@
+/**
+ * Bitmap is a compact binary image storing one bit per pixel
+ * - set pixels are the foreground (white colour)
+ * - unset pixels are the background (black colour)
+ *
+ * Pixels outside of the bitmap are considered to be background.
+ * Each row is padded to the whole number of words.
+ */
+class Bitmap {
+
+	public:
+
+	typedef unsigned long long Word;
+	static const int WORD_BITS = 64;
+
+	private:
+
+	vector<Word> data;
+	int r, c, stride;
+
+	public:
+
+	int rows() const { return r; }
+	int columns() const { return c; }
+	IntegerPoint size() const { return IntegerPoint(c,r); }
+	// number of words in one row
+	int wordsPerRow() const { return stride; }
+
+	bool valid(int x, int y) const {
+		return x >= 0 && x < columns() && y >= 0 && y < rows();
+	}
+
+	bool valid(IntegerPoint p) const {
+		return valid(p.x,p.y);
+	}
+
+	// resize the bitmap, all pixels are cleared to background
+	void resize(int columns, int rows) {
+		r = rows, c = columns;
+		stride = (columns+WORD_BITS-1) / WORD_BITS;
+		data.assign(rows*stride,0);
+	}
+
+	Bitmap(int columns = 0, int rows = 0) {
+		resize(columns,rows);
+	}
+
+	// creates the bitmap from the binarised image in one pass over its pixels
+	// - white pixels are foreground (the same test as ColorMono::mono())
+	Bitmap(const Image &image) {
+		resize(image.columns(),image.rows());
+		const PixelPacket* pixels = image.getConstPixels(0,0,c,r);
+		for (int y = 0; y < r; y++) {
+			Word* words = row(y);
+			for (int x = 0; x < c; x++) {
+				if (pixels++->green != 0)
+					words[x/WORD_BITS] |= Word(1) << (x%WORD_BITS);
+			}
+		}
+	}
+
+	const Word* row(int y) const {
+		return &data[y*stride];
+	}
+
+	Word* row(int y) {
+		return &data[y*stride];
+	}
+
+	bool get(int x, int y) const {
+		if (!valid(x,y)) return false;
+		return (data[y*stride + x/WORD_BITS] >> (x%WORD_BITS)) & 1;
+	}
+
+	bool get(IntegerPoint p) const {
+		return get(p.x,p.y);
+	}
+
+	void set(int x, int y, bool value = true) {
+		Word &word = data[y*stride + x/WORD_BITS];
+		Word bit = Word(1) << (x%WORD_BITS);
+		if (value) word |= bit; else word &= ~bit;
+	}
+
+	void set(IntegerPoint p, bool value = true) {
+		set(p.x,p.y,value);
+	}
+
+	// swaps the foreground and the background
+	void negate() {
+		for (unsigned int i = 0; i < data.size(); i++) {
+			data[i] = ~data[i];
+		}
+		clearPadding();
+	}
+
+	// clears the unused bits at the end of each row
+	void clearPadding() {
+		int used = c % WORD_BITS;
+		if (used == 0) return;
+		Word mask = (Word(1) << used) - 1;
+		for (int y = 0; y < r; y++) {
+			row(y)[stride-1] &= mask;
+		}
+	}
+
+	// bitmap created by taking every factor-th pixel in both directions
+	Bitmap subsample(int factor) const {
+		Bitmap result((c+factor-1)/factor,(r+factor-1)/factor);
+		for (int y = 0; y < result.rows(); y++) {
+			for (int x = 0; x < result.columns(); x++) {
+				if (get(x*factor,y*factor))
+					result.set(x,y);
+			}
+		}
+		return result;
+	}
+
+	// creates the black and white image of the bitmap
+	Image toImage() const {
+		Image image(Geometry(c,r),ColorMono(false));
+		PixelPacket white = ColorMono(true);
+		PixelPacket* pixels = image.getPixels(0,0,c,r);
+		for (int y = 0; y < r; y++) {
+			for (int x = 0; x < c; x++, pixels++) {
+				if (get(x,y))
+					*pixels = white;
+			}
+		}
+		image.syncPixels();
+		return image;
+	}
+
+};
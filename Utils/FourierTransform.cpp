@@ -0,0 +1,88 @@
+/**
+ * Fast Fourier transform of complex signals having the length of a power of two
+ * and the circular convolution of real signals of any length computed by it.
+ */
+namespace FourierTransform {
+
+	typedef complex<double> Complex;
+
+	// the smallest power of two not smaller than the given number
+	int powerOfTwo(int n) {
+		int power = 1;
+		while (power < n) power *= 2;
+		return power;
+	}
+
+	// in-place iterative radix-2 transform, the length must be a power of two
+	// - the inverse transform is scaled by 1/length
+	void transform(vector<Complex> &signal, bool inverse = false) {
+		int length = signal.size();
+		assert(length == powerOfTwo(length));
+
+		// bit reversal permutation
+		for (int i = 1, j = 0; i < length; i++) {
+			int bit = length >> 1;
+			for (; j & bit; bit >>= 1) j ^= bit;
+			j ^= bit;
+			if (i < j) swap(signal[i],signal[j]);
+		}
+
+		// butterflies
+		for (int size = 2; size <= length; size *= 2) {
+			double angle = (inverse ? +2 : -2) * M_PI / size;
+			Complex root(cos(angle),sin(angle));
+			for (int start = 0; start < length; start += size) {
+				Complex w(1.0);
+				for (int k = 0; k < size/2; k++) {
+					Complex a = signal[start+k];
+					Complex b = signal[start+k+size/2] * w;
+					signal[start+k] = a + b;
+					signal[start+k+size/2] = a - b;
+					w *= root;
+				}
+			}
+		}
+
+		if (inverse) {
+			for (int i = 0; i < length; i++) {
+				signal[i] /= length;
+			}
+		}
+	}
+
+	// circular convolution result[i] = sum{ signal[(i-j) % N] * kernel[j] }
+	// - computed as the linear convolution folded into the length of the signal,
+	// so the kernel can be of any length
+	vector<double> circularConvolution(const vector<double> &signal, const vector<double> &kernel) {
+		int signalLength = signal.size();
+		int kernelLength = kernel.size();
+		int length = powerOfTwo(signalLength+kernelLength-1);
+
+		vector<Complex> a(length), b(length);
+		copy(signal.begin(),signal.end(),a.begin());
+		copy(kernel.begin(),kernel.end(),b.begin());
+		transform(a);
+		transform(b);
+		for (int i = 0; i < length; i++) {
+			a[i] *= b[i];
+		}
+		transform(a,true);
+
+		vector<double> convolution(signalLength);
+		for (int i = 0; i < signalLength+kernelLength-1; i++) {
+			convolution[i%signalLength] += a[i].real();
+		}
+		return convolution;
+	}
+
+	// circular cross-correlation result[s] = sum{ a[i] * b[(i+s) % N] }
+	vector<double> circularCorrelation(const vector<double> &a, const vector<double> &b) {
+		int length = a.size();
+		vector<double> reversed(length);
+		for (int i = 0; i < length; i++) {
+			reversed[i] = a[(length-i)%length];
+		}
+		return circularConvolution(b,reversed);
+	}
+
+};
@@ -25,27 +25,63 @@ namespace Geometry2D {
 		return translate(rotate(v,t.rotationAngle), t.translation);
 	}
 	
-	// translate the set of points
-	vector<Vector> translate(vector<Vector> v, Vector offset) {
-		int length = v.size();
-		for (int i = 0; i < length; i++) {
-			v[i] = translate(v[i],offset);
+	// rigid transformation prepared to be applied to many points,
+	// the sine and cosine of the angle are computed only once
+	struct Transformer {
+		double cosine, sine;
+		Vector translation;
+		
+		Transformer(RigidTransformation t)
+			: cosine(cos(t.rotationAngle)), sine(sin(t.rotationAngle)), translation(t.translation) {
 		}
-		return v;
+		
+		Vector operator () (Vector v) const {
+			return Vector(cosine * v.x + sine * v.y + translation.x, -sine * v.x + cosine * v.y + translation.y);
+		}
+	};
+	
+	// writes the transformed points from [begin,end) to the output
+	template<class InputIterator, class OutputIterator>
+	OutputIterator transform(InputIterator begin, InputIterator end, RigidTransformation t, OutputIterator out) {
+		return std::transform(begin,end,out,Transformer(t));
+	}
+	
+	// apply rigid transformation to given set of points in place
+	void transformInPlace(vector<Vector> &v, RigidTransformation t) {
+		transform(v.begin(),v.end(),t,v.begin());
+	}
+	
+	// translate the set of points in place
+	void translateInPlace(vector<Vector> &v, Vector offset) {
+		transformInPlace(v,RigidTransformation(0.0,offset));
+	}
+	
+	// translate the set of points
+	vector<Vector> translate(const vector<Vector> &v, Vector offset) {
+		vector<Vector> result(v.size());
+		transform(v.begin(),v.end(),RigidTransformation(0.0,offset),result.begin());
+		return result;
 	}
 	
 	// rotate the set of vectors
-	vector<Vector> rotate(vector<Vector> v, double angle) {
-		int length = v.size();
-		for (int i = 0; i < length; i++) {
-			v[i] = rotate(v[i],angle);
-		}
-		return v;
+	vector<Vector> rotate(const vector<Vector> &v, double angle) {
+		vector<Vector> result(v.size());
+		transform(v.begin(),v.end(),RigidTransformation(angle),result.begin());
+		return result;
 	}
 	
 	// apply rigid transformation to given set of points
-	vector<Vector> transform(vector<Vector> v, RigidTransformation t) {
-		return translate(rotate(v,t.rotationAngle), t.translation);
+	vector<Vector> transform(const vector<Vector> &v, RigidTransformation t) {
+		vector<Vector> result(v.size());
+		transform(v.begin(),v.end(),t,result.begin());
+		return result;
+	}
+	
+	// apply rigid transformation to given set of points, the result
+	// is written into the given buffer reusing its memory
+	void transform(const vector<Vector> &v, RigidTransformation t, vector<Vector> &result) {
+		result.resize(v.size());
+		transform(v.begin(),v.end(),t,result.begin());
 	}
 	
 	double crossProduct(Vector A, Vector B) {
@@ -83,13 +119,18 @@ namespace Geometry2D {
 		return center / (3 * sumArea);
 	}
 	
-	double areaOfPolygon(const vector<Point> &polygon) {
+	// area of the polygon, the sign depends on the orientation of the polygon
+	double signedAreaOfPolygon(const vector<Point> &polygon) {
 		int length = polygon.size();
 		double sum = 0;
 		for (int i = 0; i < length; i++) {
 			sum += crossProduct(polygon[i],polygon[(i+1)%length]);
 		}
-		return abs(sum) / 2;
+		return sum / 2;
+	}
+	
+	double areaOfPolygon(const vector<Point> &polygon) {
+		return abs(signedAreaOfPolygon(polygon));
 	}
 	
 	// closest point from the set to the given point
@@ -102,11 +143,84 @@ namespace Geometry2D {
 		return best;
 	}
 	
+	// set of points bucketed into a regular grid of square cells
+	// to find the closest point without visiting all of them
+	class PointGrid {
+		const vector<Point> &set;
+		Point origin;
+		double cellSize;
+		int columns, rows;
+		// indices of the points in each cell, in the increasing order
+		vector< vector<int> > cells;
+		
+		int cellX(double x) const { return int(floor((x-origin.x) / cellSize)); }
+		int cellY(double y) const { return int(floor((y-origin.y) / cellSize)); }
+		
+		// checks the points of the cell, the smaller index wins on equal distance
+		void visitCell(int x, int y, Point point, int &best, double &bestDist) const {
+			const vector<int> &cell = cells[y*columns + x];
+			for (unsigned int i = 0; i < cell.size(); i++) {
+				double dist = (set[cell[i]]-point).squareLength();
+				if (dist < bestDist || (dist == bestDist && cell[i] < best))
+					best = cell[i], bestDist = dist;
+			}
+		}
+		
+		public:
+		
+		PointGrid(const vector<Point> &set) : set(set) {
+			Point low(+Utils::DOUBLE_INF,+Utils::DOUBLE_INF), high(-Utils::DOUBLE_INF,-Utils::DOUBLE_INF);
+			for (unsigned int i = 0; i < set.size(); i++) {
+				low  = Point(min(low.x,set[i].x),min(low.y,set[i].y));
+				high = Point(max(high.x,set[i].x),max(high.y,set[i].y));
+			}
+			origin = low;
+			// about one point per cell for points on a curve
+			double area = (high.x-low.x+1) * (high.y-low.y+1);
+			cellSize = max(1.0,sqrt(area / max(1,int(set.size()))));
+			columns = cellX(high.x)+1;
+			rows = cellY(high.y)+1;
+			cells.resize(columns*rows);
+			for (unsigned int i = 0; i < set.size(); i++) {
+				cells[cellY(set[i].y)*columns + cellX(set[i].x)].push_back(i);
+			}
+		}
+		
+		// the same point as closestPoint(point,set)
+		int closestPoint(Point point) const {
+			int cx = cellX(point.x), cy = cellY(point.y);
+			int best = 0;
+			double bestDist = Utils::DOUBLE_INF;
+			// search the rings of cells around the cell of the point, points beyond
+			// the ring r are at least r cells far
+			int maxRing = max(max(cx,columns-1-cx),max(cy,rows-1-cy));
+			for (int r = 0; r <= maxRing; r++) {
+				if (bestDist < (r-1)*cellSize * (r-1)*cellSize && r > 0)
+					break;
+				for (int y = max(0,cy-r); y <= min(rows-1,cy+r); y++) {
+					bool edgeRow = y == cy-r || y == cy+r;
+					for (int x = max(0,cx-r); x <= min(columns-1,cx+r); x++) {
+						if (edgeRow || x == cx-r || x == cx+r)
+							visitCell(x,y,point,best,bestDist);
+						else
+							x = max(x,cx+r-1);
+					}
+				}
+			}
+			return best;
+		}
+	};
+	
 	// determines for each point from the first set the closest point from the second set
 	Permutation closestPoints(const Shape &shape, const Shape &shapeTo) {
 		Permutation perm;
+		if (shapeTo.empty()) {
+			perm.assign(shape.size(),0);
+			return perm;
+		}
+		PointGrid grid(shapeTo);
 		for (unsigned int i = 0; i < shape.size(); i++) {
-			perm.push_back( closestPoint(shape[i],shapeTo) );
+			perm.push_back( grid.closestPoint(shape[i]) );
 		}
 		return perm;
 	}
@@ -124,30 +238,46 @@ namespace Geometry2D {
 	}
 	
 	// schwartz-sharir algorithm dtermines the optimal rigid transformation of the shape
-	// to match fiven pattern
-	RigidTransformation optimalAlign(const Shape &pattern, const Shape &shape) {
-		assert(shape.size() == pattern.size());
-		
-		RealPoint mean = SignalProcessor<RealPoint>::mean(shape);
-		RealPoint center = SignalProcessor<RealPoint>::mean(pattern);
+	// to match fiven pattern, the pairs of corresponding points are added one by one
+	// so they do not need to be gathered into shapes
+	class AlignAccumulator {
+		typedef complex<double> ComplexNumber;
 		
-		Shape norm = Geometry2D::translate(shape,-mean);
+		Point sumPattern, sumShape;
+		ComplexNumber sumProduct;
+		int count;
 		
-		typedef complex<double> ComplexNumber;
+		public:
 		
-		int length = shape.size();
-		ComplexNumber sum;
-		for (int i = 0; i < length; i++) {
-			ComplexNumber u(norm[i].x,norm[i].y);
-			ComplexNumber v(pattern[i].x,pattern[i].y);
-			sum += u * conj(v);
+		AlignAccumulator() : count(0) {
 		}
 		
-		double angle = arg(sum);
-		
-		mean = Geometry2D::rotate(mean,angle);
+		void add(Point pattern, Point shape) {
+			sumPattern += pattern;
+			sumShape += shape;
+			sumProduct += ComplexNumber(shape.x,shape.y) * conj(ComplexNumber(pattern.x,pattern.y));
+			count++;
+		}
 		
-		return RigidTransformation(angle,center-mean);
+		// the optimal rigid transformation of the added shape points to match the pattern points
+		RigidTransformation optimalAlign() const {
+			Point mean = sumShape / count;
+			Point center = sumPattern / count;
+			// sum of (shape - mean) * conj(pattern)
+			ComplexNumber sum = sumProduct - ComplexNumber(mean.x,mean.y) * conj(ComplexNumber(sumPattern.x,sumPattern.y));
+			double angle = arg(sum);
+			return RigidTransformation(angle,center-rotate(mean,angle));
+		}
+	};
+	
+	// optimal rigid transformation of the shape to match given pattern
+	RigidTransformation optimalAlign(const Shape &pattern, const Shape &shape) {
+		assert(shape.size() == pattern.size());
+		AlignAccumulator accumulator;
+		for (unsigned int i = 0; i < shape.size(); i++) {
+			accumulator.add(pattern[i],shape[i]);
+		}
+		return accumulator.optimalAlign();
 	}
 	
 }
@@ -0,0 +1,134 @@
+/**
+ * Counters and histograms of the hot paths of the method
+ *
+ * Every thread counts into its own copy of the values, so counting is a plain
+ * increment without any locking. The values of the workers are added to the
+ * totals when Parallel::ForEach finishes their item, the main thread is added
+ * when the report is written. The latency of scoring the pairs is measured
+ * only when the metrics are enabled.
+ *
+ * The histograms have logarithmic buckets, the bucket b counts the values
+ * in the range [2^(b-1), 2^b), the bucket 0 counts the zeros.
+ *
+ * Usage:
+ * 1. enable() the metrics before the processing starts
+ * 2. count() the events, record() the values into the histograms
+ * 3. write() the totals into a file at the end
+ */
+namespace Metrics {
+
+	enum Counter {
+		SHAPE_ALIGN_CALLS,
+		ICP_ITERATIONS,
+		DISABLE_EDGE_CALLS,
+		DISABLE_EDGE_ROWS,
+		MATCHING_SUBPROBLEMS,
+		FRAME_COMBINATIONS,
+		BEST_CHOICE_CANDIDATES,
+		KMEANS_ITERATIONS,
+		NUM_COUNTERS
+	};
+
+	const char *COUNTER_NAMES[NUM_COUNTERS] = {
+		"shape_align_calls",
+		"icp_iterations",
+		"disable_edge_calls",
+		"disable_edge_rows",
+		"matching_subproblems",
+		"frame_combinations",
+		"best_choice_candidates",
+		"kmeans_iterations"
+	};
+
+	enum Histogram {
+		// ICP iterations of one ShapeAligner::shapeAlign() call
+		ICP_ITERATIONS_PER_ALIGN,
+		// nanoseconds of recomputing the score of one pair in EdgeScores::init()
+		PAIR_SCORING_NS,
+		NUM_HISTOGRAMS
+	};
+
+	const char *HISTOGRAM_NAMES[NUM_HISTOGRAMS] = {
+		"icp_iterations_per_align",
+		"pair_scoring_ns"
+	};
+
+	// levels of the cascade counted separately, the deeper ones share the last
+	const int MAX_LEVELS = 16;
+	const int NUM_BUCKETS = 40;
+
+	struct Values {
+		long long counters[NUM_COUNTERS];
+		// pairs scored and pairs not kept for the next level of the cascade
+		long long evaluated[MAX_LEVELS], pruned[MAX_LEVELS];
+		long long histograms[NUM_HISTOGRAMS][NUM_BUCKETS];
+	};
+
+	bool enabled = false;
+	Values total;
+	boost::mutex mutex;
+
+	// values of the calling thread not yet added to the total
+	__thread Values local;
+
+	inline void count(Counter counter, long long n = 1) {
+		local.counters[counter] += n;
+	}
+
+	inline void countLevel(int level, long long evaluated, long long pruned) {
+		level = min(level,MAX_LEVELS-1);
+		local.evaluated[level] += evaluated;
+		local.pruned[level] += pruned;
+	}
+
+	inline void record(Histogram histogram, long long value) {
+		int bucket = 0;
+		while (value > 0 && bucket+1 < NUM_BUCKETS) {
+			value >>= 1;
+			bucket++;
+		}
+		local.histograms[histogram][bucket]++;
+	}
+
+	// adds the values of the calling thread to the total
+	void flush() {
+		if (!enabled) return;
+		boost::mutex::scoped_lock lock(mutex);
+		const long long *from = &local.counters[0];
+		long long *to = &total.counters[0];
+		for (unsigned int i = 0; i < sizeof(Values)/sizeof(long long); i++) {
+			to[i] += from[i];
+		}
+		memset(&local,0,sizeof(Values));
+	}
+
+	void enable() {
+		enabled = true;
+		memset(&local,0,sizeof(Values));
+	}
+
+	// writes the totals, one value per line
+	void write(const string &fileName) {
+		flush();
+		ofstream file(fileName.c_str());
+		if (!file)
+			throw "cannot write metrics file";
+		file << "# counter, value" << endl;
+		for (int i = 0; i < NUM_COUNTERS; i++) {
+			file << COUNTER_NAMES[i] << ' ' << total.counters[i] << endl;
+		}
+		file << "# level of EdgeScores::init, pairs evaluated, pairs pruned" << endl;
+		for (int i = 0; i < MAX_LEVELS; i++) {
+			if (total.evaluated[i] > 0)
+				file << "level " << i << ' ' << total.evaluated[i] << ' ' << total.pruned[i] << endl;
+		}
+		file << "# histogram, upper bound of the bucket (exclusive), count" << endl;
+		for (int h = 0; h < NUM_HISTOGRAMS; h++) {
+			for (int b = 0; b < NUM_BUCKETS; b++) {
+				if (total.histograms[h][b] > 0)
+					file << HISTOGRAM_NAMES[h] << ' ' << (1LL << b) << ' ' << total.histograms[h][b] << endl;
+			}
+		}
+	}
+
+};
@@ -6,58 +6,132 @@
  * Given images have to be binarized into black and white color,
  * - white is the color of foreground
  * - black is the color of background
+ *
+ * The operations run on a Bitmap using the euclidean distance transform,
+ * so their cost does not depend on the radius of the kernel.
  */
 class MorphologicProcessor {
-	
-	Image image;
-	
+
+	Bitmap bitmap;
+
+	// horizontal distance of each pixel in the row to the closest foreground pixel
+	// in the same row, distances are clamped to given limit
+	void rowDistances(int y, int limit, vector<unsigned char> &distance) const {
+		int columns = bitmap.columns();
+		const Bitmap::Word* words = bitmap.row(y);
+		int last = -limit;
+		for (int x = 0; x < columns; x++) {
+			if ((words[x/Bitmap::WORD_BITS] >> (x%Bitmap::WORD_BITS)) & 1)
+				last = x;
+			distance[x] = min(x-last,limit);
+		}
+		last = columns-1+limit;
+		for (int x = columns-1; x >= 0; x--) {
+			if ((words[x/Bitmap::WORD_BITS] >> (x%Bitmap::WORD_BITS)) & 1)
+				last = x;
+			distance[x] = min(int(distance[x]),min(last-x,limit));
+		}
+	}
+
+	// position where the parabolas rooted in q and p intersect
+	static inline double intersection(const vector<int> &f, int q, int p) {
+		return double((f[q]+q*q) - (f[p]+p*p)) / (2*q-2*p);
+	}
+
+	// one dimensional squared distance transform of the sampled function f
+	// d[y] = min{ (y-q)^2 + f[q] } computed as the lower envelope of parabolas
+	static void envelopeDistances(const vector<int> &f, vector<int> &d, vector<int> &v, vector<double> &z) {
+		int length = f.size();
+		int k = 0;
+		v[0] = 0;
+		z[0] = -Utils::DOUBLE_INF;
+		z[1] = +Utils::DOUBLE_INF;
+		for (int q = 1; q < length; q++) {
+			double s = intersection(f,q,v[k]);
+			while (s <= z[k]) {
+				k--;
+				s = intersection(f,q,v[k]);
+			}
+			k++;
+			v[k] = q;
+			z[k] = s;
+			z[k+1] = +Utils::DOUBLE_INF;
+		}
+		k = 0;
+		for (int y = 0; y < length; y++) {
+			while (z[k+1] < y) k++;
+			d[y] = (y-v[k])*(y-v[k]) + f[v[k]];
+		}
+	}
+
 	public:
-	
+
+	MorphologicProcessor(const Bitmap &bitmap)
+		: bitmap(bitmap) {
+	}
+
 	MorphologicProcessor(const Image &image)
-		: image(image) {
-	}
-	
-	Image& dilate(double radius) {
-		int half = radius+0.5;
-		int size = 2*half+1;
-		
-		double kernel[size*size];
-		// create kernel
-		for (int y = -half; y <= +half; y++) {
-			for (int x = -half; x <= +half; x++) {
-				if (x*x+y*y <= radius*radius)
-					kernel[(y+half)*size+x+half] = 1.0;
-				else
-					kernel[(y+half)*size+x+half] = 0.0;
+		: bitmap(image) {
+	}
+
+	// sets every pixel having a foreground pixel in the given distance
+	Bitmap& dilate(double radius) {
+		int columns = bitmap.columns();
+		int rows = bitmap.rows();
+		if (columns == 0 || rows == 0) return bitmap;
+		assert(radius < 255);
+		// distances beyond the radius only need to be known to be too far
+		int limit = int(radius)+1;
+		double maxSquare = radius*radius;
+
+		// horizontal distances for each row
+		vector<unsigned char> distances(columns*rows);
+		vector<unsigned char> rowDistance(columns);
+		for (int y = 0; y < rows; y++) {
+			rowDistances(y,limit,rowDistance);
+			copy(rowDistance.begin(),rowDistance.end(),distances.begin()+y*columns);
+		}
+
+		// combine them along the columns
+		Bitmap result(columns,rows);
+		vector<int> f(rows), d(rows), v(rows);
+		vector<double> z(rows+1);
+		for (int x = 0; x < columns; x++) {
+			for (int y = 0; y < rows; y++) {
+				int h = distances[y*columns+x];
+				f[y] = h*h;
+			}
+			envelopeDistances(f,d,v,z);
+			for (int y = 0; y < rows; y++) {
+				if (d[y] <= maxSquare)
+					result.set(x,y);
 			}
 		}
-		image.convolve(size,kernel);
-		
-		image.threshold(0.5); 
-		
-		return image;
-	}
-	
-	Image& erode(double radius) {
-		image.negate();
+
+		bitmap = result;
+		return bitmap;
+	}
+
+	Bitmap& erode(double radius) {
+		bitmap.negate();
 		dilate(radius);
-		image.negate();
-		return image;
+		bitmap.negate();
+		return bitmap;
 	}
-	
-	Image& open(double radius) {
+
+	Bitmap& open(double radius) {
 		erode(radius);
 		return dilate(radius);
 	}
-	
-	Image& close(double radius) {
+
+	Bitmap& close(double radius) {
 		dilate(radius);
 		return erode(radius);
 	}
-	
-	Image& smooth(double radius) {
+
+	Bitmap& smooth(double radius) {
 		open(radius);
 		return close(radius);
 	}
-	
+
 };
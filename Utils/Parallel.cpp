@@ -5,6 +5,24 @@ namespace Parallel {
 	
 	using boost::thread;
 	using boost::thread_group;
+	
+	// runs the member function on the object in its own lane of the trace,
+	// the metrics counted by the thread are added to the total
+	template<class C>
+	void run(C *object, void (C::*f)()) {
+		Trace::enterLane();
+		(object->*f)();
+		Trace::leaveLane();
+		Metrics::flush();
+	}
+	
+	template<class C, class I>
+	void run(C *object, void (C::*f)(const I &param), const I &param) {
+		Trace::enterLane();
+		(object->*f)(param);
+		Trace::leaveLane();
+		Metrics::flush();
+	}
 
 	// parallel execute the member function with signature f() on every given object
 	// and gather the results
@@ -13,8 +31,7 @@ namespace Parallel {
 		for (unsigned int i = 0; i < obj.size();) {
 			thread_group threads;
 			for (int j = 0; i < obj.size() && j < NUM_THREADS; i++, j++) {
-				cout << '.' << flush;
-				threads.add_thread(new thread(boost::bind(f, &obj[i])));
+				threads.add_thread(new thread(boost::bind(&run<C>, &obj[i], f)));
 			}
 			threads.join_all();
 		}
@@ -26,8 +43,7 @@ namespace Parallel {
 		for (unsigned int i = 0; i < obj.size();) {
 			thread_group threads;
 			for (int j = 0; i < obj.size() && j < NUM_THREADS; i++, j++) {
-				cout << '.' << flush;
-				threads.add_thread(new thread(boost::bind(f, &obj[i], param)));
+				threads.add_thread(new thread(boost::bind(&run<C,I>, &obj[i], f, param)));
 			}
 			threads.join_all();
 		}
@@ -0,0 +1,319 @@
+/**
+ * Planar image stores each colour channel of an image as a separate plane
+ * of 8-bit samples in the row-major order.
+ *
+ * The image is filled once from the decoded Image and the pixel kernels
+ * (histogram, value, threshold, integral image, 3x3 median and edge filters)
+ * run directly on the planes, using SSE2 where available.
+ */
+class PlanarImage {
+
+	public:
+
+	typedef vector<unsigned char> Plane;
+
+	enum Channel { RED = 0, GREEN = 1, BLUE = 2 };
+
+	private:
+
+	Plane planes[3];
+	int r, c;
+
+	static inline unsigned char sample(Quantum quantum) {
+		return Color::scaleQuantumToDouble(quantum) * 255 + 0.5;
+	}
+
+	// operations on a single sample used by the 3x3 kernels
+	struct ScalarOps {
+		typedef unsigned char Vector;
+		static const int WIDTH = 1;
+		static Vector load(const unsigned char* p) { return *p; }
+		static void store(unsigned char* p, Vector v) { *p = v; }
+		static Vector minimum(Vector a, Vector b) { return min(a,b); }
+		static Vector maximum(Vector a, Vector b) { return max(a,b); }
+		// max(0,min(255, 9*center - sum))
+		static Vector edge(const Vector p[9]) {
+			int sum = 0;
+			for (int i = 0; i < 9; i++) sum += p[i];
+			return max(0,min(255,9*p[4]-sum));
+		}
+	};
+
+#ifdef __SSE2__
+	// the same operations on 16 samples at once
+	struct VectorOps {
+		typedef __m128i Vector;
+		static const int WIDTH = 16;
+		static Vector load(const unsigned char* p) { return _mm_loadu_si128((const __m128i*)p); }
+		static void store(unsigned char* p, Vector v) { _mm_storeu_si128((__m128i*)p,v); }
+		static Vector minimum(Vector a, Vector b) { return _mm_min_epu8(a,b); }
+		static Vector maximum(Vector a, Vector b) { return _mm_max_epu8(a,b); }
+		static Vector edge(const Vector p[9]) {
+			const __m128i zero = _mm_setzero_si128();
+			__m128i low = _mm_setzero_si128(), high = _mm_setzero_si128();
+			for (int i = 0; i < 9; i++) {
+				low  = _mm_sub_epi16(low,_mm_unpacklo_epi8(p[i],zero));
+				high = _mm_sub_epi16(high,_mm_unpackhi_epi8(p[i],zero));
+			}
+			__m128i lowCenter = _mm_unpacklo_epi8(p[4],zero), highCenter = _mm_unpackhi_epi8(p[4],zero);
+			for (int i = 0; i < 9; i++) {
+				low  = _mm_add_epi16(low,lowCenter);
+				high = _mm_add_epi16(high,highCenter);
+			}
+			// the packing saturates to 0..255
+			return _mm_packus_epi16(low,high);
+		}
+	};
+#endif
+
+	template<class Ops>
+	static inline void sortPair(typename Ops::Vector &a, typename Ops::Vector &b) {
+		typename Ops::Vector t = Ops::minimum(a,b);
+		b = Ops::maximum(a,b);
+		a = t;
+	}
+
+	// median of 9 values by the sorting network with 19 comparisons
+	template<class Ops>
+	static typename Ops::Vector median9(const typename Ops::Vector values[9]) {
+		typename Ops::Vector p[9];
+		copy(values,values+9,p);
+		sortPair<Ops>(p[1],p[2]); sortPair<Ops>(p[4],p[5]); sortPair<Ops>(p[7],p[8]);
+		sortPair<Ops>(p[0],p[1]); sortPair<Ops>(p[3],p[4]); sortPair<Ops>(p[6],p[7]);
+		sortPair<Ops>(p[1],p[2]); sortPair<Ops>(p[4],p[5]); sortPair<Ops>(p[7],p[8]);
+		sortPair<Ops>(p[0],p[3]); sortPair<Ops>(p[5],p[8]); sortPair<Ops>(p[4],p[7]);
+		sortPair<Ops>(p[3],p[6]); sortPair<Ops>(p[1],p[4]); sortPair<Ops>(p[2],p[5]);
+		sortPair<Ops>(p[4],p[7]); sortPair<Ops>(p[4],p[2]); sortPair<Ops>(p[6],p[4]);
+		sortPair<Ops>(p[4],p[2]);
+		return p[4];
+	}
+
+	// copy of the plane with one more sample on each side repeating the border samples
+	static Plane padded(const Plane &plane, int columns, int rows) {
+		int width = columns+2;
+		Plane result(width*(rows+2));
+		for (int y = -1; y <= rows; y++) {
+			const unsigned char* samples = &plane[max(0,min(rows-1,y))*columns];
+			unsigned char* padded = &result[(y+1)*width];
+			padded[0] = samples[0];
+			copy(samples,samples+columns,padded+1);
+			padded[width-1] = samples[columns-1];
+		}
+		return result;
+	}
+
+	// applies the 3x3 kernel to the samples [from,to) of one row of the padded plane
+	template<class Ops, bool MEDIAN>
+	static int filterRow(const Plane &source, int width, int y, int from, int to, unsigned char* result) {
+		typename Ops::Vector p[9];
+		int x = from;
+		for (; x+Ops::WIDTH <= to; x += Ops::WIDTH) {
+			for (int dy = 0; dy < 3; dy++) {
+				for (int dx = 0; dx < 3; dx++) {
+					p[3*dy+dx] = Ops::load(&source[(y+dy)*width + x+dx]);
+				}
+			}
+			Ops::store(result+x, MEDIAN ? median9<Ops>(p) : Ops::edge(p));
+		}
+		return x;
+	}
+
+	// applies the 3x3 kernel to the plane, the samples outside are the nearest border samples
+	template<bool MEDIAN>
+	static Plane filter(const Plane &plane, int columns, int rows) {
+		Plane source = padded(plane,columns,rows);
+		Plane result(columns*rows);
+		for (int y = 0; y < rows; y++) {
+			unsigned char* row = &result[y*columns];
+			int x = 0;
+#ifdef __SSE2__
+			x = filterRow<VectorOps,MEDIAN>(source,columns+2,y,x,columns,row);
+#endif
+			filterRow<ScalarOps,MEDIAN>(source,columns+2,y,x,columns,row);
+		}
+		return result;
+	}
+
+	public:
+
+	int rows() const { return r; }
+	int columns() const { return c; }
+
+	// reads the pixels of the image in one pass
+	PlanarImage(const Image &image) {
+		r = image.rows(), c = image.columns();
+		for (int k = 0; k < 3; k++) {
+			planes[k].resize(r*c);
+		}
+		const PixelPacket* pixels = image.getConstPixels(0,0,c,r);
+		for (int i = 0; i < r*c; i++, pixels++) {
+			planes[RED][i]   = sample(pixels->red);
+			planes[GREEN][i] = sample(pixels->green);
+			planes[BLUE][i]  = sample(pixels->blue);
+		}
+	}
+
+	const Plane& plane(Channel channel) const {
+		return planes[channel];
+	}
+
+	// bilinear interpolation of the channel in the given point, the centers
+	// of pixels have integer coordinates, outside points use the border pixels
+	double interpolate(Channel channel, RealPoint p) const {
+		double x = max(0.0,min(double(c-1),p.x));
+		double y = max(0.0,min(double(r-1),p.y));
+		int x0 = int(x), y0 = int(y);
+		int x1 = min(x0+1,c-1), y1 = min(y0+1,r-1);
+		double fx = x-x0, fy = y-y0;
+		const Plane &plane = planes[channel];
+		double top    = plane[y0*c+x0] * (1-fx) + plane[y0*c+x1] * fx;
+		double bottom = plane[y1*c+x0] * (1-fx) + plane[y1*c+x1] * fx;
+		return top * (1-fy) + bottom * fy;
+	}
+
+	// the value component of HSV, maximum of the red, green and blue component
+	Plane value() const {
+		int length = r*c;
+		Plane result(length);
+		const unsigned char *red = &planes[RED][0], *green = &planes[GREEN][0], *blue = &planes[BLUE][0];
+		int i = 0;
+#ifdef __SSE2__
+		for (; i+16 <= length; i += 16) {
+			__m128i m = _mm_max_epu8(
+				_mm_loadu_si128((const __m128i*)(red+i)),
+				_mm_loadu_si128((const __m128i*)(green+i))
+			);
+			m = _mm_max_epu8(m,_mm_loadu_si128((const __m128i*)(blue+i)));
+			_mm_storeu_si128((__m128i*)(&result[i]),m);
+		}
+#endif
+		for (; i < length; i++) {
+			result[i] = max(red[i],max(green[i],blue[i]));
+		}
+		return result;
+	}
+
+	// the rectangular part of the plane
+	static Plane crop(const Plane &plane, int columns, int x, int y, int width, int height) {
+		Plane result(width*height);
+		for (int i = 0; i < height; i++) {
+			const unsigned char* row = &plane[(y+i)*columns + x];
+			copy(row,row+width,result.begin()+i*width);
+		}
+		return result;
+	}
+
+	// maximum of the planes in each sample
+	static Plane maximum(const Plane &a, const Plane &b) {
+		int length = a.size();
+		Plane result(length);
+		int i = 0;
+#ifdef __SSE2__
+		for (; i+16 <= length; i += 16) {
+			VectorOps::store(&result[i],VectorOps::maximum(VectorOps::load(&a[i]),VectorOps::load(&b[i])));
+		}
+#endif
+		for (; i < length; i++) {
+			result[i] = max(a[i],b[i]);
+		}
+		return result;
+	}
+
+	// 3x3 median filter removing the noise, used instead of Image::reduceNoise()
+	// which is a different noise peak elimination filter
+	static Plane median(const Plane &plane, int columns, int rows) {
+		return filter<true>(plane,columns,rows);
+	}
+
+	// 3x3 edge detection filter, 8 times the sample minus its neighbours (as Image::edge())
+	static Plane edge(const Plane &plane, int columns, int rows) {
+		return filter<false>(plane,columns,rows);
+	}
+
+	// histogram of the samples of the plane, the range 0..255 is split into given number of levels
+	static vector<int> histogram(const Plane &plane, int numLevels = 256) {
+		// four partial histograms avoid waiting on the same counter
+		vector<int> partial[4];
+		for (int k = 0; k < 4; k++) {
+			partial[k].resize(256);
+		}
+		int length = plane.size();
+		int i = 0;
+		for (; i+4 <= length; i += 4) {
+			partial[0][plane[i+0]]++;
+			partial[1][plane[i+1]]++;
+			partial[2][plane[i+2]]++;
+			partial[3][plane[i+3]]++;
+		}
+		for (; i < length; i++) {
+			partial[0][plane[i]]++;
+		}
+		vector<int> histogram(numLevels);
+		for (int v = 0; v < 256; v++) {
+			histogram[v * (numLevels-1) / 255] += partial[0][v] + partial[1][v] + partial[2][v] + partial[3][v];
+		}
+		return histogram;
+	}
+
+	// binarizes the plane, samples greater than the threshold are foreground
+	static Bitmap threshold(const Plane &plane, int columns, int rows, double threshold) {
+		Bitmap bitmap(columns,rows);
+		int level = floor(threshold);
+		if (level >= 255) return bitmap;
+		for (int y = 0; y < rows; y++) {
+			const unsigned char* samples = &plane[y*columns];
+			Bitmap::Word* words = bitmap.row(y);
+			int x = 0;
+#ifdef __SSE2__
+			if (level >= 0) {
+				// unsigned comparison using the signed one
+				const __m128i bias = _mm_set1_epi8(char(0x80));
+				const __m128i limit = _mm_set1_epi8(char(level ^ 0x80));
+				for (; x+16 <= columns; x += 16) {
+					__m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(samples+x)),bias);
+					Bitmap::Word bits = (unsigned int)_mm_movemask_epi8(_mm_cmpgt_epi8(v,limit));
+					words[x/Bitmap::WORD_BITS] |= bits << (x%Bitmap::WORD_BITS);
+				}
+			}
+#endif
+			for (; x < columns; x++) {
+				if (samples[x] > level)
+					words[x/Bitmap::WORD_BITS] |= Bitmap::Word(1) << (x%Bitmap::WORD_BITS);
+			}
+		}
+		return bitmap;
+	}
+
+	// table of prefix sums, sums[(y+1)*(columns+1)+(x+1)] is the sum of samples
+	// in the rectangle [0,x]x[0,y], the first row and column are zero
+	static void integral(const Plane &plane, int columns, int rows, vector<unsigned int> &sums) {
+		int width = columns+1;
+		sums.assign(width*(rows+1),0);
+		for (int y = 0; y < rows; y++) {
+			const unsigned char* samples = &plane[y*columns];
+			unsigned int* above = &sums[y*width];
+			unsigned int* current = &sums[(y+1)*width];
+			// prefix sums of the row
+			unsigned int sum = 0;
+			for (int x = 0; x < columns; x++) {
+				sum += samples[x];
+				current[x+1] = sum;
+			}
+			// add the row above
+			int x = 0;
+#ifdef __SSE2__
+			for (; x+4 <= width; x += 4) {
+				__m128i s = _mm_add_epi32(
+					_mm_loadu_si128((const __m128i*)(current+x)),
+					_mm_loadu_si128((const __m128i*)(above+x))
+				);
+				_mm_storeu_si128((__m128i*)(current+x),s);
+			}
+#endif
+			for (; x < width; x++) {
+				current[x] += above[x];
+			}
+		}
+	}
+
+};
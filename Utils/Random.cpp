@@ -0,0 +1,43 @@
+/**
+ * Deterministic pseudo-random generator for the synthetic inputs
+ *
+ * The linear congruential generator does not depend on the C library,
+ * so the same seed gives the same sequence on every platform.
+ */
+class Random {
+	unsigned long long state;
+	
+	public:
+	
+	Random(unsigned long long seed) : state(seed) {
+	}
+	
+	// uniformly distributed number from [0,1)
+	double uniform() {
+		state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+		return (state >> 11) * (1.0 / 9007199254740992.0);
+	}
+	
+	// uniformly distributed integer from [0,n)
+	int integer(int n) {
+		return int(uniform() * n);
+	}
+	
+	// normally distributed number with zero mean and given deviation (Box-Muller)
+	double normal(double deviation) {
+		double u = 1.0 - uniform();
+		return deviation * sqrt(-2.0 * log(u)) * cos(2 * M_PI * uniform());
+	}
+	
+	// random permutation of 0..n-1
+	Permutation permutation(int n) {
+		Permutation p(n);
+		for (int i = 0; i < n; i++) {
+			p[i] = i;
+		}
+		for (int i = n-1; i > 0; i--) {
+			swap(p[i],p[integer(i+1)]);
+		}
+		return p;
+	}
+};
@@ -45,6 +45,49 @@ namespace ShapeUtils {
 		return image;
 	}
 	
+	// bitmap of the component defined by the closed curve, the same pixels as
+	// in shapeMask are foreground, i.e. the interior without the curve itself
+	Bitmap shapeBitmap(int columns, int rows, const Shape &shape) {
+		Bitmap curve(columns,rows);
+		for (unsigned int i = 0; i < shape.size(); i++) {
+			IntegerPoint p = Utils::convert(shape[i]);
+			if (curve.valid(p))
+				curve.set(p);
+		}
+		// flood the exterior from all border pixels
+		Bitmap exterior(columns,rows);
+		vector<IntegerPoint> stack;
+		for (int x = 0; x < columns; x++) {
+			stack.push_back(IntegerPoint(x,0));
+			stack.push_back(IntegerPoint(x,rows-1));
+		}
+		for (int y = 0; y < rows; y++) {
+			stack.push_back(IntegerPoint(0,y));
+			stack.push_back(IntegerPoint(columns-1,y));
+		}
+		while (!stack.empty()) {
+			IntegerPoint p = stack.back();
+			stack.pop_back();
+			if (!curve.valid(p) || curve.get(p) || exterior.get(p))
+				continue;
+			exterior.set(p);
+			for (int d = 0; d < 4; d++) {
+				stack.push_back(p + Utils::Direction[d]);
+			}
+		}
+		// the rest is the interior
+		Bitmap interior(columns,rows);
+		for (int y = 0; y < rows; y++) {
+			const Bitmap::Word *c = curve.row(y), *e = exterior.row(y);
+			Bitmap::Word* words = interior.row(y);
+			for (int i = 0; i < interior.wordsPerRow(); i++) {
+				words[i] = ~(c[i] | e[i]);
+			}
+		}
+		interior.clearPadding();
+		return interior;
+	}
+	
 	// mirro the shape
 	Shape flipShape(Shape shape) {
 		for (unsigned int i = 0; i < shape.size(); i++)
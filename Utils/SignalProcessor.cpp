@@ -18,14 +18,20 @@ template<class T> class SignalProcessor {
 		return exp(-sqr(x-u) / (2*sqr(sigma))) / (sqrt(2*M_PI) * sigma);
 	}
 
+	// writes the cyclic part of the vector from begin to end to the output
+	template<class OutputIterator>
+	static OutputIterator interval(const Signal &signal, int begin, int end, OutputIterator out) {
+		if (begin < end)
+			return copy(signal.begin()+begin,signal.begin()+end+1,out);
+		out = copy(signal.begin()+begin,signal.end(),out);
+		return copy(signal.begin(),signal.begin()+end+1,out);
+	}
+
 	// cuts the part of the vector
 	static Signal interval(const Signal &signal, int begin, int end) {
 		Signal segment;
-		do {
-			segment.push_back(signal[begin]);
-			begin = (begin+1)%signal.size();
-		} while (begin != end);
-		segment.push_back(signal[end]);
+		segment.reserve(begin < end ? end-begin+1 : signal.size()-begin+end+1);
+		interval(signal,begin,end,back_inserter(segment));
 		return segment;
 	}
 
@@ -51,21 +57,84 @@ template<class T> class SignalProcessor {
 		return true;
 	}
 
-	static vector<T> circularConvolution(vector<T> signal, vector<double> kernel) {
+	// kernels at least this long are convolved by the FFT, if the signal allows it
+	static const int FFT_KERNEL_LENGTH = 64;
+
+	// the periodic signal is extended on both sides by this multiple of sigma
+	// before the recursive gaussian blur
+	static const int CIRCULAR_BLUR_PADDING = 6;
+
+	static vector<T> directCircularConvolution(const vector<T> &signal, const vector<double> &kernel) {
 		int signalLength = signal.size();
 		int kernelLength = kernel.size();
 	
 		vector<T> convolution(signalLength);
 	
 		for (int i = 0; i < signalLength; i++) {
+			int index = i;
 			for (int j = 0; j < kernelLength; j++) {
-				convolution[i] += signal[(i-j+signalLength)%signalLength] * kernel[j];
+				convolution[i] += signal[index] * kernel[j];
+				if (--index < 0) index = signalLength-1;
 			}
 		}
 	
 		return convolution;
 	}
 
+	static vector<T> circularConvolution(const vector<T> &signal, const vector<double> &kernel) {
+		return directCircularConvolution(signal,kernel);
+	}
+
+	// coefficients of the recursive approximation of the gaussian filter
+	// by Young and van Vliet, b[0] is the gain of the input sample
+	static void recursiveGaussianCoefficients(double sigma, double b[4]) {
+		double q = sigma >= 2.5 ? 0.98711*sigma - 0.96330 : 3.97156 - 4.14554*sqrt(1-0.26891*sigma);
+		double b0 = 1.57825 + 2.44413*q + 1.4281*q*q + 0.422205*q*q*q;
+		b[1] = (2.44413*q + 2.85619*q*q + 1.26661*q*q*q) / b0;
+		b[2] = -(1.4281*q*q + 1.26661*q*q*q) / b0;
+		b[3] = 0.422205*q*q*q / b0;
+		b[0] = 1 - (b[1]+b[2]+b[3]);
+	}
+
+	// gaussian blur in O(n) by the forward and the backward recursive filter,
+	// samples outside of the signal are equal to the border samples
+	// - sigma has to be at least 0.5
+	static Signal recursiveGaussianBlur(const Signal &signal, double sigma) {
+		int length = signal.size();
+		if (length == 0) return signal;
+		double b[4];
+		recursiveGaussianCoefficients(sigma,b);
+	
+		Signal forward(length), result(length);
+		T w1 = signal[0], w2 = signal[0], w3 = signal[0];
+		for (int i = 0; i < length; i++) {
+			T w = signal[i]*b[0] + w1*b[1] + w2*b[2] + w3*b[3];
+			forward[i] = w;
+			w3 = w2, w2 = w1, w1 = w;
+		}
+		T y1 = forward[length-1], y2 = forward[length-1], y3 = forward[length-1];
+		for (int i = length-1; i >= 0; i--) {
+			T y = forward[i]*b[0] + y1*b[1] + y2*b[2] + y3*b[3];
+			result[i] = y;
+			y3 = y2, y2 = y1, y1 = y;
+		}
+		return result;
+	}
+
+	// gaussian blur of the periodic signal in O(n), the signal is extended by its
+	// periodic continuation for the recursive filter to settle
+	static Signal circularGaussianBlur(const Signal &signal, double sigma) {
+		int length = signal.size();
+		if (length == 0) return signal;
+		int padding = int(ceil(CIRCULAR_BLUR_PADDING * sigma));
+		Signal extended(length + 2*padding);
+		for (int i = 0; i < int(extended.size()); i++) {
+			extended[i] = signal[((i-padding)%length + length)%length];
+		}
+		extended = recursiveGaussianBlur(extended,sigma);
+		return Signal(extended.begin()+padding,extended.begin()+padding+length);
+	}
+
 	static vector<T> difference(const vector<T> &signal) {
 		int length = signal.size();
 		vector<T> diff(length);
@@ -135,69 +204,80 @@ template<class T> class SignalProcessor {
 		return difference;
 	}
 
-	// resample the given signal to given length
-	static Signal resample(const Signal &signal, int sampleLength) {
+	// resample the given signal to given length, the result is written
+	// into the given buffer reusing its memory
+	static void resample(const Signal &signal, int sampleLength, Signal &sample) {
 		int length = signal.size();
-		Signal sample(sampleLength);
+		sample.resize(sampleLength);
 		for (int i = 0; i < sampleLength; i++) {
 			int j = Utils::Convert(double(i) * (length-1) / (sampleLength-1));
 			sample[i] = signal[j];
 		}
+	}
+
+	// resample the given signal to given length
+	static Signal resample(const Signal &signal, int sampleLength) {
+		Signal sample;
+		resample(signal,sampleLength,sample);
 		return sample;
 	}
 
 	// resample the given signal using certain scale
 	static Signal resample(const Signal &signal, double scale) {
-		int length = signal.size();
-		int sampleLength = Utils::Convert(length * scale);
-		Signal sample(sampleLength);
-		for (int i = 0; i < sampleLength; i++) {
-			int j = Utils::Convert(double(i) * (length-1) / (sampleLength-1));
-			sample[i] = signal[j];
-		}
-		return sample;
+		return resample(signal,Utils::Convert(signal.size() * scale));
 	}
 
-	// convovle the given signal with gauss kernel
-	static vector<T> averageFilter(vector<T> signal, int kernelLength) {
+	// convovle the given signal with the box kernel, the sum of the window
+	// is updated while it slides along the signal
+	static vector<T> averageFilter(const vector<T> &signal, int kernelLength) {
 		int length = signal.size();
 		int kernelHalf = kernelLength/2;
 	
+		T window = T();
+		for (int j = -kernelHalf; j <= +kernelHalf; j++) {
+			window += signal[((j%length)+length)%length];
+		}
 		vector<T> result(length);
 		for (int i = 0; i < length; i++) {
-			for (int j = -kernelHalf; j <= +kernelHalf; j++) {
-				result[i] += signal[(i+j+length)%length];
-			}
-			result[i] /= kernelLength;
+			result[i] = window / kernelLength;
+			window += signal[(i+kernelHalf+1)%length];
+			window -= signal[((i-kernelHalf)%length+length)%length];
 		}
 	
 		return result;
 	}
 
-	static Signal multiply(Signal signal, T val) {
+	static void multiplyInPlace(Signal &signal, T val) {
 		int length = signal.size();
 		for (int i = 0; i < length; i++) {
 			signal[i] *= val;
 		}
-		return signal;
+	}
+
+	static Signal multiply(const Signal &signal, T val) {
+		Signal result = signal;
+		multiplyInPlace(result,val);
+		return result;
 	}
 
 	static Signal normalize(const Signal &signal) {
 		return multiply(signal,1.0/sum(signal));
 	}
 
-	// reduce noise, low pass filter
-	// gaussian curve is from -3o to +3o
-	static vector<T> gaussianBlur(vector<T> signal, double sigma) {
+	// reduce noise, low pass filter of the periodic signal
+	// gaussian curve is from -3o to +3o, larger sigmas use the recursive filter
+	static vector<T> gaussianBlur(const vector<T> &signal, double sigma) {
+		if (sigma >= 0.5)
+			return circularGaussianBlur(signal,sigma);
 		int halfLength = 3*sigma;
 		vector<double> kernel;
 		for (int i = -halfLength; i <= +halfLength; i++) {
 			kernel.push_back( exp(- i*i / (2 * sigma * sigma)) / (sqrt( 2 * M_PI ) * sigma) );
 		}
-		kernel = normalize(kernel);
-		signal = circularConvolution(signal,kernel);
-		rotate(signal.begin(),signal.begin()+halfLength,signal.end());
-		return signal;
+		SignalProcessor<double>::multiplyInPlace(kernel,1.0/SignalProcessor<double>::sum(kernel));
+		vector<T> result = circularConvolution(signal,kernel);
+		rotate(result.begin(),result.begin()+halfLength,result.end());
+		return result;
 	}
 	
 	// returns all local maximas which are maximas in at least given radius of neighbourhood
@@ -233,3 +313,11 @@ template<class T> class SignalProcessor {
 	}
 
 };
+
+// real signals with long kernels are convolved by the FFT
+template<>
+vector<double> SignalProcessor<double>::circularConvolution(const vector<double> &signal, const vector<double> &kernel) {
+	if (int(kernel.size()) >= FFT_KERNEL_LENGTH)
+		return FourierTransform::circularConvolution(signal,kernel);
+	return directCircularConvolution(signal,kernel);
+}
@@ -0,0 +1,111 @@
+/**
+ * Tracing of the stages of the method
+ *
+ * A Trace::Span measures the scope it lives in. When the tracing is enabled
+ * the finished spans are collected together with the lane of the thread
+ * they ran in and written in the Chrome trace format, which can be opened
+ * in chrome://tracing or ui.perfetto.dev. A disabled span costs one test of a flag.
+ *
+ * Parallel::ForEach starts a new thread for every object, so the threads
+ * are not identified by themselves but by lanes: the main thread has lane 0
+ * and every worker takes the smallest lane free while it runs.
+ *
+ * Usage:
+ * 1. enable() the tracing before the processing starts
+ * 2. put Trace::Span span("name") at the beginning of the traced scope,
+ *    the name has to be a string literal
+ * 3. write() the collected spans into a file at the end
+ */
+namespace Trace {
+
+	// one finished span
+	struct Event {
+		const char *name;
+		int lane;
+		// start from enabling the tracing and duration in microseconds
+		double start, duration;
+		// optional number describing the span, e.g. the level or the iteration
+		int argument;
+	};
+
+	bool enabled = false;
+	double origin = 0.0;
+	vector<Event> events;
+	vector<bool> lanesInUse(1,true);
+	boost::mutex mutex;
+
+	// lane of the calling thread
+	__thread int lane = 0;
+
+	// the calling worker thread takes the smallest free lane
+	void enterLane() {
+		if (!enabled) return;
+		boost::mutex::scoped_lock lock(mutex);
+		lane = find(lanesInUse.begin(),lanesInUse.end(),false) - lanesInUse.begin();
+		if (lane == int(lanesInUse.size()))
+			lanesInUse.push_back(true);
+		lanesInUse[lane] = true;
+	}
+
+	void leaveLane() {
+		if (!enabled || lane == 0) return;
+		boost::mutex::scoped_lock lock(mutex);
+		lanesInUse[lane] = false;
+		lane = 0;
+	}
+
+	// monotonic time in microseconds
+	double now() {
+		timespec t;
+		clock_gettime(CLOCK_MONOTONIC,&t);
+		return t.tv_sec * 1e6 + t.tv_nsec * 1e-3;
+	}
+
+	void enable() {
+		enabled = true;
+		origin = now();
+	}
+
+	class Span {
+		const char *name;
+		int argument;
+		double start;
+
+		public:
+
+		Span(const char *name, int argument = -1)
+			: name(name), argument(argument), start(enabled ? now() : 0.0) {
+		}
+
+		~Span() {
+			if (!enabled) return;
+			Event event = { name, lane, start-origin, now()-start, argument };
+			boost::mutex::scoped_lock lock(mutex);
+			events.push_back(event);
+		}
+	};
+
+	// writes the collected spans as complete events of the Chrome trace format
+	void write(const string &fileName) {
+		ofstream file(fileName.c_str());
+		if (!file)
+			throw "cannot write trace file";
+		file << fixed << setprecision(1);
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << endl;
+		// names of the lanes, the main lane always exists
+		for (unsigned int i = 0; i < lanesInUse.size(); i++) {
+			file << (i > 0 ? "," : "") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i
+			     << ",\"args\":{\"name\":\"" << (i == 0 ? "main" : "worker") << " " << i << "\"}}" << endl;
+		}
+		for (unsigned int i = 0; i < events.size(); i++) {
+			const Event &e = events[i];
+			file << ",{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.lane
+			     << ",\"ts\":" << e.start << ",\"dur\":" << e.duration;
+			if (e.argument >= 0)
+				file << ",\"args\":{\"n\":" << e.argument << "}";
+			file << "}" << endl;
+		}
+		file << "]}" << endl;
+	}
+
+};
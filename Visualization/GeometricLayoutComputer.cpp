@@ -34,12 +34,8 @@ class GeometricLayoutComputer {
 	void addPDep(Dependencies &dep, EdgeRef up1, EdgeRef up2, int dir) {
 		if (up1 == NULL || up2 == NULL) return;
 		
-		EdgeRef edge1 = up1->next;
-		EdgeRef edge2 = up2->prev;
-		for (int i = 0; i < dir; i++) {
-			edge1 = edge1->next;
-			edge2 = edge2->next;
-		}
+		EdgeRef edge1 = up1->following(dir+1);
+		EdgeRef edge2 = up2->following(dir+3);
 		
 		dep.PDep.push_back((PieceToPieceDependency) {
 			up1->piece, up2->piece, aligner.shapeAlign(edge2->shape,edge1->shape).t
@@ -50,10 +46,7 @@ class GeometricLayoutComputer {
 	void addFDep(Dependencies &dep, EdgeRef up, int dir) {
 		if (up == NULL) return;
 		
-		EdgeRef edge = up->next;
-		for (int i = 0; i < dir; i++) {
-			edge = edge->next;
-		}
+		EdgeRef edge = up->following(dir+1);
 		
 		dep.FDep[dir].push_back((PieceToFrameDependency) {
 			edge->piece, aligner.lineAlign(edge->shape,Utils::DegreesToRadians(90*(3-dir)))
@@ -176,6 +169,7 @@ class GeometricLayoutComputer {
 	
 	// computes the geometric layout of the given combinatoric solution
 	GeometricLayout computeLayout(const PuzzleLayout &layout) {
+		Trace::Span span("GeometricLayoutComputer::computeLayout");
 		pair<Dependencies,PieceOrientations> dep = GetDependencies(layout);
 		int numPieces = dep.second.size();
 		// rotate the pieces in approximately correct direction
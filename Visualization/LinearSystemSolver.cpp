@@ -51,6 +51,7 @@ template <class T> class LinearSystemSolver {
 	}
 	
 	PieceValues solve() {
+		Trace::Span span("LinearSystemSolver::solve",columns);
 		using namespace arma;
 		// create matrix
 		mat matrix = zeros<mat> (dep.size()+val.size(),columns);
@@ -33,6 +33,7 @@ class Visualizer {
 	
 	// paints one single piece at the defined place of the resulting image
 	void drawPiece(PieceRef piece, RigidTransformation position) {
+		Trace::Span span("Visualizer::drawPiece",piece->id);
 		Image pixels = piecePixels(piece);
 		Shape shape = Geometry2D::translate(pieceShape(piece), ImageCenter(pixels));
 		
@@ -40,7 +41,7 @@ class Visualizer {
 			ShapeUtils::shapeMask(pixels.size(),shape)
 		);
 		
-		Image mask = processor.erode(VISUALIZATION_ERODE);
+		Image mask = processor.erode(VISUALIZATION_ERODE).toImage();
 		pixels.composite(mask,0,0,MultiplyCompositeOp);
 		
 		pixels.backgroundColor(ColorMono(false));
@@ -62,6 +63,7 @@ class Visualizer {
 	public:
 	// returns the visualized solution of the given combinatoric solution
 	Image visualize(const PuzzleLayout &puzzleLayout) {
+		Trace::Span span("Visualizer::visualize");
 		GeometricLayoutComputer computer;
 		// compute the geometric layout
 		GeometricLayout layout = computer.computeLayout(puzzleLayout);